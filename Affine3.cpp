@@ -0,0 +1,225 @@
+#include <iostream>
+#include <iomanip>
+#include "Affine3.h"
+#include "Quaternion.h"
+#include <math.h>
+
+// constructor - default to the identity
+Affine3::Affine3()
+    { // constructor
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 4; col++)
+            coordinates[row][col] = (row == col) ? 1.0f : 0.0f;
+    } // constructor
+
+// take the top three rows of a matrix that is known to be affine
+Affine3::Affine3(const Matrix4 &matrix)
+    { // constructor
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 4; col++)
+            coordinates[row][col] = matrix.coordinates[row][col];
+    } // constructor
+
+// equality operator
+bool Affine3::operator ==(const Affine3 &other) const
+    { // operator ==()
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 4; col++)
+            if (coordinates[row][col] != other.coordinates[row][col])
+                return false;
+    return true;
+    } // operator ==()
+
+// indexing - retrieves the beginning of a line
+// array indexing will then retrieve an element
+float * Affine3::operator [](const int rowIndex)
+    { // operator []
+    return coordinates[rowIndex];
+    } // operator []
+
+// similar routine for const pointers
+const float * Affine3::operator [](const int rowIndex) const
+    { // operator []
+    return coordinates[rowIndex];
+    } // operator []
+
+// composition: the result applies other first, then this
+// 36 multiplies instead of the 64 of a full matrix product
+Affine3 Affine3::operator *(const Affine3 &other) const
+    { // operator *()
+    Affine3 productMatrix;
+    for (int row = 0; row < 3; row++)
+        { // per row
+        const float *a = coordinates[row];
+        for (int col = 0; col < 4; col++)
+            productMatrix.coordinates[row][col] = a[0] * other.coordinates[0][col] + a[1] * other.coordinates[1][col] + a[2] * other.coordinates[2][col];
+        // the implied bottom row of other only contributes to the translation
+        productMatrix.coordinates[row][3] += a[3];
+        } // per row
+    return productMatrix;
+    } // operator *()
+
+// transform a point (the translation applies)
+Cartesian3 Affine3::operator *(const Cartesian3 &point) const
+    { // operator *()
+    return Cartesian3(
+        coordinates[0][0] * point.x + coordinates[0][1] * point.y + coordinates[0][2] * point.z + coordinates[0][3],
+        coordinates[1][0] * point.x + coordinates[1][1] * point.y + coordinates[1][2] * point.z + coordinates[1][3],
+        coordinates[2][0] * point.x + coordinates[2][1] * point.y + coordinates[2][2] * point.z + coordinates[2][3]);
+    } // operator *()
+
+// transform a direction (the translation does not apply)
+Cartesian3 Affine3::TransformVector(const Cartesian3 &vector) const
+    { // TransformVector()
+    return Cartesian3(
+        coordinates[0][0] * vector.x + coordinates[0][1] * vector.y + coordinates[0][2] * vector.z,
+        coordinates[1][0] * vector.x + coordinates[1][1] * vector.y + coordinates[1][2] * vector.z,
+        coordinates[2][0] * vector.x + coordinates[2][1] * vector.y + coordinates[2][2] * vector.z);
+    } // TransformVector()
+
+// the translation column, i.e. where the origin goes
+Cartesian3 Affine3::Translation() const
+    { // Translation()
+    return Cartesian3(coordinates[0][3], coordinates[1][3], coordinates[2][3]);
+    } // Translation()
+
+void Affine3::SetTranslation(const Cartesian3 &vector)
+    { // SetTranslation()
+    for (int row = 0; row < 3; row++)
+        coordinates[row][3] = vector[row];
+    } // SetTranslation()
+
+// the inverse of a rigid transform
+Affine3 Affine3::Inverse() const
+    { // Inverse()
+    // the inverse of a rotation is its transpose
+    Affine3 inverse;
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 3; col++)
+            inverse.coordinates[row][col] = coordinates[col][row];
+
+    // and undo the translation after it
+    inverse.SetTranslation(-inverse.TransformVector(Translation()));
+    return inverse;
+    } // Inverse()
+
+// the same transform as a full matrix
+Matrix4 Affine3::ToMatrix4() const
+    { // ToMatrix4()
+    Matrix4 returnMatrix;
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 4; col++)
+            returnMatrix.coordinates[row][col] = coordinates[row][col];
+    returnMatrix.coordinates[3][3] = 1.0f;
+    return returnMatrix;
+    } // ToMatrix4()
+
+// the rotation part as a quaternion, the inverse of Quaternion::ToRotationAffine()
+// which stores the transpose of the usual rotation matrix, hence the swapped indices
+Quaternion Affine3::ToQuaternion() const
+    { // ToQuaternion()
+    const float (&r)[3][4] = coordinates;
+    float trace = r[0][0] + r[1][1] + r[2][2];
+    // pick the largest of w, x, y and z to divide by, for accuracy
+    if (trace > 0.0f)
+        { // w largest
+        float s = sqrt(trace + 1.0f) * 2.0f;
+        return Quaternion(0.25f * s, (r[1][2] - r[2][1]) / s, (r[2][0] - r[0][2]) / s, (r[0][1] - r[1][0]) / s);
+        } // w largest
+    if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+        { // x largest
+        float s = sqrt(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+        return Quaternion((r[1][2] - r[2][1]) / s, 0.25f * s, (r[1][0] + r[0][1]) / s, (r[2][0] + r[0][2]) / s);
+        } // x largest
+    if (r[1][1] > r[2][2])
+        { // y largest
+        float s = sqrt(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+        return Quaternion((r[2][0] - r[0][2]) / s, (r[1][0] + r[0][1]) / s, 0.25f * s, (r[2][1] + r[1][2]) / s);
+        } // y largest
+    // z largest
+    float s = sqrt(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+    return Quaternion((r[0][1] - r[1][0]) / s, (r[2][0] + r[0][2]) / s, (r[2][1] + r[1][2]) / s, 0.25f * s);
+    } // ToQuaternion()
+
+// the identity transform
+Affine3 Affine3::Identity()
+    { // Identity()
+    // the constructor already sets it up
+    return Affine3();
+    } // Identity()
+
+Affine3 Affine3::Translate(const Cartesian3 &vector)
+    { // Translate()
+    Affine3 returnMatrix;
+    returnMatrix.SetTranslation(vector);
+    return returnMatrix;
+    } // Translate()
+
+// a rotation by a (unit) quaternion, then a translation
+Affine3 Affine3::Rigid(const Quaternion &rotation, const Cartesian3 &translation)
+    { // Rigid()
+    Affine3 returnMatrix = rotation.ToRotationAffine();
+    returnMatrix.SetTranslation(translation);
+    return returnMatrix;
+    } // Rigid()
+
+// the same as Matrix4::RotateDirection()
+Affine3 Affine3::RotateDirection(const Cartesian3& direction, const Cartesian3& up)
+    { // RotateDirection()
+    Cartesian3 xaxis = up.cross(direction).unit();
+    Cartesian3 yaxis = direction.cross(xaxis).unit();
+
+    // the axes go down the columns
+    Affine3 out;
+    for (int row = 0; row < 3; row++)
+        { // per row
+        out.coordinates[row][0] = xaxis[row];
+        out.coordinates[row][1] = yaxis[row];
+        out.coordinates[row][2] = direction[row];
+        out.coordinates[row][3] = 0.0f;
+        } // per row
+    return out;
+    } // RotateDirection()
+
+// the same as Matrix4::Look(), which has no translation
+Affine3 Affine3::Look(const Cartesian3& position, const Cartesian3& target, const Cartesian3& up)
+    { // Look()
+    Cartesian3 forward = target - position;
+    Cartesian3 right = up.cross(forward);
+    Cartesian3 x = right.unit();
+    Cartesian3 y = forward.cross(right).unit();
+    Cartesian3 z = forward.unit();
+
+    // the axes go along the rows
+    Affine3 out;
+    for (int col = 0; col < 3; col++)
+        { // per column
+        out.coordinates[0][col] = x[col];
+        out.coordinates[1][col] = y[col];
+        out.coordinates[2][col] = z[col];
+        } // per column
+    return out;
+    } // Look()
+
+// a full matrix applied after an affine one
+Matrix4 operator *(const Matrix4 &matrix, const Affine3 &affine)
+    { // operator *()
+    Matrix4 productMatrix;
+    for (int row = 0; row < 4; row++)
+        { // per row
+        const float *a = matrix.coordinates[row];
+        for (int col = 0; col < 4; col++)
+            productMatrix.coordinates[row][col] = a[0] * affine.coordinates[0][col] + a[1] * affine.coordinates[1][col] + a[2] * affine.coordinates[2][col];
+        productMatrix.coordinates[row][3] += a[3];
+        } // per row
+    return productMatrix;
+    } // operator *()
+
+// stream output
+std::ostream & operator << (std::ostream &outStream, const Affine3 &matrix)
+    { // operator <<()
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 4; col++)
+            outStream << std::setw(12) << std::setprecision(5) << std::fixed << matrix.coordinates[row][col] << ((col == 3) ? "\n" : " ");
+    return outStream;
+    } // operator <<()
@@ -0,0 +1,80 @@
+// include guard
+#ifndef AFFINE3_H
+#define AFFINE3_H
+
+#include <iostream>
+#include "Cartesian3.h"
+#include "Matrix4.h"
+
+// forward declaration
+class Quaternion;
+
+// an affine transform: the top three rows of a 4x4 matrix whose bottom row
+// is always 0 0 0 1, so it is never stored or multiplied, and points never
+// need a perspective division
+// stored in row-major form, with the translation in the last column
+class Affine3
+    { // Affine3
+    public:
+    // the coordinates
+    float coordinates[3][4];
+
+    // constructor - default to the identity
+    Affine3();
+
+    // take the top three rows of a matrix that is known to be affine
+    explicit Affine3(const Matrix4 &matrix);
+
+    // equality operator
+    bool operator ==(const Affine3 &other) const;
+
+    // indexing - retrieves the beginning of a line
+    // array indexing will then retrieve an element
+    float * operator [](const int rowIndex);
+
+    // similar routine for const pointers
+    const float * operator [](const int rowIndex) const;
+
+    // composition: the result applies other first, then this
+    Affine3 operator *(const Affine3 &other) const;
+
+    // transform a point (the translation applies)
+    Cartesian3 operator *(const Cartesian3 &point) const;
+
+    // transform a direction (the translation does not apply)
+    Cartesian3 TransformVector(const Cartesian3 &vector) const;
+
+    // the translation column, i.e. where the origin goes
+    Cartesian3 Translation() const;
+    void SetTranslation(const Cartesian3 &vector);
+
+    // the inverse of a rigid transform: the transposed rotation, then the negated
+    // rotated translation (the linear part must be a pure rotation)
+    Affine3 Inverse() const;
+
+    // the same transform as a full matrix
+    Matrix4 ToMatrix4() const;
+
+    // the rotation part as a quaternion, the inverse of Quaternion::ToRotationAffine()
+    // the linear part must be a pure rotation
+    Quaternion ToQuaternion() const;
+
+    // the identity transform
+    static Affine3 Identity();
+    static Affine3 Translate(const Cartesian3 &vector);
+
+    // a rotation by a (unit) quaternion, then a translation
+    static Affine3 Rigid(const Quaternion &rotation, const Cartesian3 &translation);
+
+    // the same as the Matrix4 versions
+    static Affine3 RotateDirection(const Cartesian3& direction, const Cartesian3& up = Cartesian3(0.f, 1.f, 0.f));
+    static Affine3 Look(const Cartesian3& position, const Cartesian3& target, const Cartesian3& up);
+    }; // Affine3
+
+// a full matrix applied after an affine one
+Matrix4 operator *(const Matrix4 &matrix, const Affine3 &affine);
+
+// stream output
+std::ostream & operator << (std::ostream &outStream, const Affine3 &value);
+
+#endif
@@ -10,8 +10,15 @@
 #include <GL/glu.h>
 #endif
 
+#include <QOpenGLContext>
 #include "AnimationCycleWidget.h"
 
+// look up GL entry points in the widget's context
+static void* ContextProcAddress(const char* name)
+	{ // ContextProcAddress()
+	return reinterpret_cast<void*>(QOpenGLContext::currentContext()->getProcAddress(name));
+	} // ContextProcAddress()
+
 // constructor
 AnimationCycleWidget::AnimationCycleWidget(QWidget *parent, SceneModel *TheScene)
 	: _GEOMETRIC_WIDGET_PARENT_CLASS(parent),
@@ -21,19 +28,24 @@ AnimationCycleWidget::AnimationCycleWidget(QWidget *parent, SceneModel *TheScene
 	animationTimer = new QTimer(this);
 	// connect it to the desired slot
 	connect(animationTimer, SIGNAL(timeout()), this, SLOT(nextFrame()));
-	// set the timer to fire 24 times a second
-	animationTimer->start((double)41.6667);
+	// set the timer to fire about 60 times a second: the scene's clock steps the
+	// simulation at its own fixed rate, and each redraw interpolates between steps
+	animationTimer->start(16);
 	} // constructor
 
 // destructor
 AnimationCycleWidget::~AnimationCycleWidget()
 	{ // destructor
-	// nothing yet
+	// the scene's buffers and shaders go with the context
+	makeCurrent();
+	theScene->ReleaseGL();
+	doneCurrent();
 	} // destructor																	
 
 // called when OpenGL context is set up
 void AnimationCycleWidget::initializeGL()
 	{ // AnimationCycleWidget::initializeGL()
+	theScene->InitialiseGL(ContextProcAddress);
 	} // AnimationCycleWidget::initializeGL()
 
 // called every time the widget is resized
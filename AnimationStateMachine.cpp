@@ -0,0 +1,191 @@
+#include "AnimationStateMachine.h"
+#include "BVHData.h"
+#include <algorithm>
+#include <cmath>
+
+// add a state playing a clip, returning its index
+int AnimationStateMachine::AddState(const std::string& name, const ClipHandle& clip)
+	{ // AddState()
+	states.push_back(State{ name, clip, nullptr });
+	return states.size() - 1;
+	} // AddState()
+
+// add a state playing a blend space at the character's parameter, returning its index
+int AnimationStateMachine::AddState(const std::string& name, const std::shared_ptr<const BlendSpace1D>& space)
+	{ // AddState()
+	states.push_back(State{ name, ClipHandle(), space });
+	return states.size() - 1;
+	} // AddState()
+
+// allow a transition, cross-fading over the given number of seconds
+void AnimationStateMachine::AddTransition(int from, int to, float crossFade)
+	{ // AddTransition()
+	transitions.push_back(Transition{ from, to, std::max(crossFade, 0.0f) });
+	} // AddTransition()
+
+// compile the rules into the lookup table
+void AnimationStateMachine::Compile()
+	{ // Compile()
+	int stateCount = states.size();
+	table.assign(stateCount * stateCount, NO_TRANSITION);
+	// the rules from any state go in first, so that particular ones overwrite them
+	for (int pass = 0; pass < 2; pass++)
+		for (const Transition& transition : transitions)
+			{ // per transition
+			if ((transition.from == ANY_STATE) != (pass == 0))
+				continue;
+			for (int from = 0; from < stateCount; from++)
+				if ((transition.from == ANY_STATE && from != transition.to) || transition.from == from)
+					table[from * stateCount + transition.to] = transition.crossFade;
+			} // per transition
+	} // Compile()
+
+// the index of the named state, or -1
+int AnimationStateMachine::FindState(const std::string& name) const
+	{ // FindState()
+	for (int state = 0; state < StateCount(); state++)
+		if (states[state].name == name)
+			return state;
+	return -1;
+	} // FindState()
+
+// a character starting out in a state
+AnimationStateInstance AnimationStateMachine::Start(int state) const
+	{ // Start()
+	AnimationStateInstance instance;
+	instance.current = state;
+	instance.requested = -1;
+	for (int slot = 0; slot < MAX_FADING_STATES; slot++)
+		{ // per slot
+		instance.fading[slot] = -1;
+		instance.fadingShare[slot] = 0.0f;
+		} // per slot
+	instance.stateTime = 0.0f;
+	instance.fadeDuration = 0.0f;
+	instance.parameter = 0.0f;
+	instance.phase = 0.0f;
+	return instance;
+	} // Start()
+
+// advance characters by dt seconds, taking up their requests
+void AnimationStateMachine::Update(AnimationStateInstance* instances, size_t count, float dt) const
+	{ // Update()
+	int stateCount = states.size();
+	for (size_t index = 0; index < count; index++)
+		{ // per character
+		AnimationStateInstance& instance = instances[index];
+		// a request is one table lookup; one that is not allowed (or not a state) is dropped
+		if (instance.requested >= 0 && instance.requested < stateCount && instance.requested != instance.current)
+			{ // change of state
+			float crossFade = table[instance.current * stateCount + instance.requested];
+			if (crossFade != NO_TRANSITION)
+				{ // allowed
+				// fade out of the pose as it is now: the current state at its weight, and
+				// whatever it was still fading out of sharing the rest as they did
+				// (a state twice over plays the same either way, so it is kept once)
+				float weight = FadeWeight(instance);
+				int16_t outgoing[MAX_FADING_STATES + 1] = { instance.current };
+				float share[MAX_FADING_STATES + 1] = { weight };
+				int count = 1;
+				for (int slot = 0; slot < MAX_FADING_STATES && weight < 1.0f; slot++)
+					if (instance.fading[slot] >= 0)
+						{ // still fading out
+						int same = std::find(outgoing, outgoing + count, instance.fading[slot]) - outgoing;
+						if (same == count)
+							{ // another state
+							outgoing[count] = instance.fading[slot];
+							share[count++] = 0.0f;
+							} // another state
+						share[same] += (1.0f - weight) * instance.fadingShare[slot];
+						} // still fading out
+				// with one too many, the smallest share goes and the others make up for it
+				if (count > MAX_FADING_STATES)
+					{ // drop one
+					int smallest = std::min_element(share, share + count) - share;
+					float dropped = share[smallest];
+					outgoing[smallest] = outgoing[count - 1];
+					share[smallest] = share[count - 1];
+					count--;
+					for (int slot = 0; slot < count; slot++)
+						share[slot] /= 1.0f - dropped;
+					} // drop one
+				for (int slot = 0; slot < MAX_FADING_STATES; slot++)
+					{ // per slot
+					instance.fading[slot] = (slot < count) ? outgoing[slot] : -1;
+					instance.fadingShare[slot] = (slot < count) ? share[slot] : 0.0f;
+					} // per slot
+				instance.current = instance.requested;
+				instance.stateTime = 0.0f;
+				instance.fadeDuration = crossFade;
+				} // allowed
+			} // change of state
+		instance.requested = -1;
+
+		instance.stateTime += dt;
+		if (instance.stateTime >= instance.fadeDuration)
+			for (int slot = 0; slot < MAX_FADING_STATES; slot++)
+				instance.fading[slot] = -1;
+
+		// the phase moves on at the rate of the blend space playing, at the current parameter
+		const BlendSpace1D* space = states[instance.current].space.get();
+		double cycle = (space != nullptr) ? space->CycleDuration(instance.parameter) : 0.0;
+		if (cycle > 0.0)
+			{ // in a blend space
+			double phase = instance.phase + dt / cycle;
+			instance.phase = (float) (phase - std::floor(phase));
+			} // in a blend space
+		} // per character
+	} // Update()
+
+// how far a character is through its cross-fade, 1 once it is done
+float AnimationStateMachine::FadeWeight(const AnimationStateInstance& instance)
+	{ // FadeWeight()
+	if (instance.fading[0] < 0 || instance.fadeDuration <= 0.0f)
+		return 1.0f;
+	return std::min(instance.stateTime / instance.fadeDuration, 1.0f);
+	} // FadeWeight()
+
+// the weighted clips a character is playing at a frame
+void AnimationStateMachine::Inputs(const AnimationStateInstance& instance, int frame, std::vector<BlendInput>& inputs) const
+	{ // Inputs()
+	StateInputs(instance, std::max(frame, 0), 0.0, inputs);
+	} // Inputs()
+
+// the same at a time in seconds
+void AnimationStateMachine::InputsAtTime(const AnimationStateInstance& instance, double time, std::vector<BlendInput>& inputs) const
+	{ // InputsAtTime()
+	StateInputs(instance, -1, time, inputs);
+	} // InputsAtTime()
+
+// the inputs at a frame, or at a time if frame is negative
+void AnimationStateMachine::StateInputs(const AnimationStateInstance& instance, int frame, double time, std::vector<BlendInput>& inputs) const
+	{ // StateInputs()
+	inputs.clear();
+	float weight = FadeWeight(instance);
+	auto input = [&](int state, float stateWeight)
+		{ // input()
+		// blend spaces are sampled at the character's parameter and phase
+		if (states[state].space)
+			{ // blend space
+			states[state].space->Inputs(instance.parameter, instance.phase, stateWeight, inputs);
+			return;
+			} // blend space
+		const BVHData* clip = states[state].clip.get();
+		if (clip == nullptr || clip->frame_count <= 0)
+			return;
+		if (frame >= 0)
+			{ // at a frame
+			inputs.push_back(BlendInput{ clip, frame % clip->frame_count, stateWeight });
+			return;
+			} // at a frame
+		// at a time, which may fall between two frames
+		double position = clip->FramePosition(time);
+		int clipFrame = std::min((int) position, clip->frame_count - 1);
+		inputs.push_back(BlendInput{ clip, clipFrame, stateWeight, (float) (position - clipFrame) });
+		}; // input()
+	if (weight < 1.0f)
+		for (int slot = 0; slot < MAX_FADING_STATES; slot++)
+			if (instance.fading[slot] >= 0)
+				input(instance.fading[slot], (1.0f - weight) * instance.fadingShare[slot]);
+	input(instance.current, weight);
+	} // StateInputs()
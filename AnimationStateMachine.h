@@ -0,0 +1,115 @@
+#ifndef _ANIMATION_STATE_MACHINE_H
+#define _ANIMATION_STATE_MACHINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BlendTree.h"
+
+// a transition from any state
+const int ANY_STATE = -1;
+
+// marks a pair of states with no transition between them in the lookup table
+const float NO_TRANSITION = -1.0f;
+
+// the most states a character fades out of at once, when cross-fades interrupt each other
+const int MAX_FADING_STATES = 3;
+
+// the runtime state of one character playing a state machine
+// plain data, so that whole arrays of characters can be updated in one loop
+struct AnimationStateInstance
+	{ // struct AnimationStateInstance
+	// the state playing and the one asked for (or -1)
+	int16_t current;
+	int16_t requested;
+	// the states being faded out of (or -1), and the share of each in the pose faded out of,
+	// frozen when the fade began so that an interrupted fade carries on from where it was
+	int16_t fading[MAX_FADING_STATES];
+	float fadingShare[MAX_FADING_STATES];
+	// seconds since the current state was entered, and the length of its cross-fade
+	float stateTime;
+	float fadeDuration;
+	// where the character is along the blend spaces it plays (e.g. the steering angle),
+	// and how far through their cycle, 0 to 1, shared so cross-fades between them stay in step
+	float parameter;
+	float phase;
+	}; // struct AnimationStateInstance
+
+// the immutable part of a state machine: which clip each state plays, and which
+// transitions are allowed with what cross-fade, shared by every character that plays it
+class AnimationStateMachine
+	{ // class AnimationStateMachine
+	public:
+	// add a state playing a clip, returning its index
+	int AddState(const std::string& name, const ClipHandle& clip);
+
+	// add a state playing a blend space at the character's parameter, returning its index
+	int AddState(const std::string& name, const std::shared_ptr<const BlendSpace1D>& space);
+
+	// allow a transition, cross-fading over the given number of seconds
+	// from may be ANY_STATE; a rule between two particular states wins over one from any state
+	void AddTransition(int from, int to, float crossFade);
+
+	// compile the rules into the lookup table, once all the states and transitions are in
+	void Compile();
+
+	// the states
+	int StateCount() const { return states.size(); }
+	const std::string& StateName(int state) const { return states[state].name; }
+	// the clip a state plays, which is null for a blend space
+	const ClipHandle& StateClip(int state) const { return states[state].clip; }
+	// the index of the named state, or -1
+	int FindState(const std::string& name) const;
+
+	// the cross-fade from one state to another, or NO_TRANSITION
+	float CrossFade(int from, int to) const { return table[from * states.size() + to]; }
+
+	// a character starting out in a state
+	AnimationStateInstance Start(int state) const;
+
+	// ask for a character to move to a state, which the next Update takes up if it is allowed
+	// (and drops if there is no such state)
+	static void Request(AnimationStateInstance& instance, int state) { instance.requested = state; }
+
+	// move a character along its blend spaces, e.g. as it steers
+	static void SetParameter(AnimationStateInstance& instance, float parameter) { instance.parameter = parameter; }
+
+	// advance characters by dt seconds, taking up their requests and moving their phase
+	// on at the rate of the blend space they are playing
+	void Update(AnimationStateInstance* instances, size_t count, float dt) const;
+
+	// how far a character is through its cross-fade, 1 once it is done
+	static float FadeWeight(const AnimationStateInstance& instance);
+
+	// the weighted clips a character is playing at a frame, each clip wrapping round on its own
+	// the inputs vector is reused, so this does not allocate once it has grown
+	void Inputs(const AnimationStateInstance& instance, int frame, std::vector<BlendInput>& inputs) const;
+
+	// the same at a time in seconds, each clip playing at its own frame rate
+	// with how far each clip is on towards its next frame
+	void InputsAtTime(const AnimationStateInstance& instance, double time, std::vector<BlendInput>& inputs) const;
+
+	private:
+	// the inputs at a frame, or at a time if frame is negative
+	void StateInputs(const AnimationStateInstance& instance, int frame, double time, std::vector<BlendInput>& inputs) const;
+
+	struct State
+		{ // struct State
+		std::string name;
+		ClipHandle clip;
+		std::shared_ptr<const BlendSpace1D> space;
+		}; // struct State
+	struct Transition
+		{ // struct Transition
+		int from;
+		int to;
+		float crossFade;
+		}; // struct Transition
+	std::vector<State> states;
+	std::vector<Transition> transitions;
+	// the cross-fade from state i to state j at [i * StateCount() + j]
+	std::vector<float> table;
+	}; // class AnimationStateMachine
+
+#endif
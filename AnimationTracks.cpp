@@ -0,0 +1,207 @@
+#include "AnimationTracks.h"
+#include <cstring>
+#include <new>
+
+// alignment of the buffer in bytes (one cache line)
+static const std::align_val_t TRACK_ALIGNMENT = std::align_val_t(TRACK_ROW_FLOATS * sizeof(float));
+
+// round a row length up to a whole number of cache lines
+static size_t PadRow(size_t length)
+	{ // PadRow()
+	return (length + TRACK_ROW_FLOATS - 1) / TRACK_ROW_FLOATS * TRACK_ROW_FLOATS;
+	} // PadRow()
+
+// allocate an aligned buffer of floats
+static float* AllocateTracks(size_t nFloats)
+	{ // AllocateTracks()
+	if (nFloats == 0)
+		return nullptr;
+	return static_cast<float*>(::operator new[](nFloats * sizeof(float), TRACK_ALIGNMENT));
+	} // AllocateTracks()
+
+// and release it again
+static void FreeTracks(float* data)
+	{ // FreeTracks()
+	if (data != nullptr)
+		::operator delete[](data, TRACK_ALIGNMENT);
+	} // FreeTracks()
+
+// constructor - starts out empty
+AnimationTracks::AnimationTracks()
+	: data(nullptr), totalFloats(0), frameCount(0), jointCount(0), channelCount(0), channelStride(0), jointStride(0),
+	channels(nullptr), rotation{ nullptr, nullptr, nullptr }, orientation{ nullptr, nullptr, nullptr, nullptr }
+	{ // constructor
+	} // constructor
+
+// destructor releases the buffer
+AnimationTracks::~AnimationTracks()
+	{ // destructor
+	Release();
+	} // destructor
+
+// copies duplicate the buffer (or share the view)
+AnimationTracks::AnimationTracks(const AnimationTracks& other)
+	: AnimationTracks()
+	{ // copy constructor
+	*this = other;
+	} // copy constructor
+
+// moves steal it
+AnimationTracks::AnimationTracks(AnimationTracks&& other) noexcept
+	: AnimationTracks()
+	{ // move constructor
+	*this = std::move(other);
+	} // move constructor
+
+// copy assignment
+AnimationTracks& AnimationTracks::operator =(const AnimationTracks& other)
+	{ // operator =()
+	if (this == &other)
+		return *this;
+	Release();
+	if (other.viewOwner)
+		{ // shared view
+		data = other.data;
+		viewOwner = other.viewOwner;
+		} // shared view
+	else
+		{ // own copy
+		data = AllocateTracks(other.totalFloats);
+		if (other.totalFloats != 0)
+			memcpy(data, other.data, other.totalFloats * sizeof(float));
+		} // own copy
+	totalFloats = other.totalFloats;
+	frameCount = other.frameCount;
+	jointCount = other.jointCount;
+	channelCount = other.channelCount;
+	channelStride = other.channelStride;
+	jointStride = other.jointStride;
+	SetupTracks();
+	return *this;
+	} // operator =()
+
+// move assignment
+AnimationTracks& AnimationTracks::operator =(AnimationTracks&& other) noexcept
+	{ // operator =()
+	if (this == &other)
+		return *this;
+	Release();
+	data = other.data;
+	viewOwner = std::move(other.viewOwner);
+	totalFloats = other.totalFloats;
+	frameCount = other.frameCount;
+	jointCount = other.jointCount;
+	channelCount = other.channelCount;
+	channelStride = other.channelStride;
+	jointStride = other.jointStride;
+	SetupTracks();
+	// leave the other one empty
+	other.data = nullptr;
+	other.Clear();
+	return *this;
+	} // operator =()
+
+// allocate zeroed storage for the given sizes, dropping anything held before
+void AnimationTracks::Resize(int frames, int joints, int nChannels)
+	{ // Resize()
+	Release();
+	frameCount = frames;
+	jointCount = joints;
+	channelCount = nChannels;
+	channelStride = (int) PadRow(nChannels);
+	jointStride = (int) PadRow(joints);
+	totalFloats = LayoutFloats(frames, joints, nChannels);
+	data = AllocateTracks(totalFloats);
+	if (totalFloats != 0)
+		memset(data, 0, totalFloats * sizeof(float));
+	SetupTracks();
+	} // Resize()
+
+// use tracks laid out as Resize lays them out that live elsewhere, keeping their owner alive
+void AnimationTracks::View(const float* tracks, int frames, int joints, int nChannels, std::shared_ptr<const void> owner)
+	{ // View()
+	Release();
+	frameCount = frames;
+	jointCount = joints;
+	channelCount = nChannels;
+	channelStride = (int) PadRow(nChannels);
+	jointStride = (int) PadRow(joints);
+	totalFloats = LayoutFloats(frames, joints, nChannels);
+	// never written through: only the const accessors are used on a view
+	data = const_cast<float*>(tracks);
+	viewOwner = std::move(owner);
+	SetupTracks();
+	} // View()
+
+// release the storage
+void AnimationTracks::Clear()
+	{ // Clear()
+	Release();
+	totalFloats = 0;
+	frameCount = jointCount = channelCount = channelStride = jointStride = 0;
+	SetupTracks();
+	} // Clear()
+
+// the number of floats Resize allocates for the given sizes
+size_t AnimationTracks::LayoutFloats(size_t frames, size_t joints, size_t nChannels)
+	{ // LayoutFloats()
+	return frames * (PadRow(nChannels) + 7 * PadRow(joints));
+	} // LayoutFloats()
+
+// free the buffer if it is ours, or let go of the view
+void AnimationTracks::Release()
+	{ // Release()
+	if (!viewOwner)
+		FreeTracks(data);
+	viewOwner.reset();
+	data = nullptr;
+	} // Release()
+
+// point the track pointers into the buffer
+void AnimationTracks::SetupTracks()
+	{ // SetupTracks()
+	if (data == nullptr)
+		{ // nothing allocated
+		channels = rotation[0] = rotation[1] = rotation[2] = nullptr;
+		orientation[0] = orientation[1] = orientation[2] = orientation[3] = nullptr;
+		return;
+		} // nothing allocated
+	// channels first, then the three rotation axes and the four orientation components
+	channels = data;
+	float* next = channels + (size_t) frameCount * channelStride;
+	for (int axis = 0; axis < 3; axis++)
+		{ // per axis
+		rotation[axis] = next;
+		next += (size_t) frameCount * jointStride;
+		} // per axis
+	for (int component = 0; component < 4; component++)
+		{ // per component
+		orientation[component] = next;
+		next += (size_t) frameCount * jointStride;
+		} // per component
+	} // SetupTracks()
+
+// convert the rotations of a frame into normalized quaternions, composed in each joint's channel order
+// this is the only place the trigonometry is done, so sampling is just a load
+void AnimationTracks::ComputeOrientations(int frame, const std::vector<JointChannels>& layout)
+	{ // ComputeOrientations()
+	static const Cartesian3 AXES[3] = { Cartesian3(1.0f, 0.0f, 0.0f), Cartesian3(0.0f, 1.0f, 0.0f), Cartesian3(0.0f, 0.0f, 1.0f) };
+	size_t row = (size_t) frame * jointStride;
+	for (int joint = 0; joint < jointCount; joint++)
+		{ // per joint
+		// composed as (third * second) * first in listed order, so XYZ gives Z * Y * X
+		const int* order = ROTATION_AXES[layout[joint].rotationOrder];
+		Quaternion axisRotation[3];
+		for (int step = 0; step < 3; step++)
+			{ // per axis
+			int axis = order[step];
+			axisRotation[step] = Quaternion(rotation[axis][row + joint], AXES[axis]);
+			axisRotation[step].Normalize();
+			} // per axis
+		Quaternion result = (axisRotation[2] * axisRotation[1]) * axisRotation[0];
+		orientation[0][row + joint] = result.w;
+		orientation[1][row + joint] = result.x;
+		orientation[2][row + joint] = result.y;
+		orientation[3][row + joint] = result.z;
+		} // per joint
+	} // ComputeOrientations()
@@ -0,0 +1,133 @@
+#ifndef _ANIMATION_TRACKS_H
+#define _ANIMATION_TRACKS_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "Cartesian3.h"
+#include "Quaternion.h"
+#include "JointChannels.h"
+
+// rows of every track are padded to a multiple of this many floats (one cache line)
+const int TRACK_ROW_FLOATS = 16;
+
+// all of the per-frame data of a clip in a single aligned allocation
+// stored as structure-of-arrays:
+//	channels					frameCount rows of ChannelStride() floats, raw values in file order
+//	rotation x, y and z		frameCount rows of JointStride() floats each, one track per axis
+//	orientation w, x, y, z	frameCount rows of JointStride() floats each, one track per component
+// a frame of any track is one contiguous, cache-line aligned row indexed by joint (or channel)
+// the buffer is either allocated here or viewed in place (e.g. inside a mapped .bvhc), and a
+// viewed buffer is read-only: the non-const accessors are only for tracks filled by Resize
+class AnimationTracks
+	{ // class AnimationTracks
+	public:
+	// constructor - starts out empty
+	AnimationTracks();
+	// destructor releases the buffer
+	~AnimationTracks();
+
+	// copies duplicate the buffer (or share the view), moves steal it
+	AnimationTracks(const AnimationTracks& other);
+	AnimationTracks(AnimationTracks&& other) noexcept;
+	AnimationTracks& operator =(const AnimationTracks& other);
+	AnimationTracks& operator =(AnimationTracks&& other) noexcept;
+
+	// allocate zeroed storage for the given sizes, dropping anything held before
+	void Resize(int frames, int joints, int nChannels);
+
+	// use tracks laid out as Resize lays them out that live elsewhere, keeping their owner alive
+	void View(const float* tracks, int frames, int joints, int nChannels, std::shared_ptr<const void> owner);
+
+	// release the storage
+	void Clear();
+
+	// the number of floats Resize allocates for the given sizes
+	static size_t LayoutFloats(size_t frames, size_t joints, size_t nChannels);
+
+	// sizes
+	int FrameCount() const { return frameCount; }
+	int JointCount() const { return jointCount; }
+	int ChannelCount() const { return channelCount; }
+
+	// distance in floats between consecutive frames of each kind of track
+	int ChannelStride() const { return channelStride; }
+	int JointStride() const { return jointStride; }
+
+	// the raw channel values of a frame
+	float* FrameChannels(int frame) { return channels + (size_t) frame * channelStride; }
+	const float* FrameChannels(int frame) const { return channels + (size_t) frame * channelStride; }
+
+	// a single raw channel value
+	float Channel(int frame, int channel) const { return channels[(size_t) frame * channelStride + channel]; }
+
+	// the start of one axis of the rotation tracks: element [frame * JointStride() + joint]
+	float* RotationTrack(int axis) { return rotation[axis]; }
+	const float* RotationTrack(int axis) const { return rotation[axis]; }
+
+	// gather the rotation of one joint in one frame
+	Cartesian3 Rotation(int frame, int joint) const
+		{ // Rotation()
+		size_t index = (size_t) frame * jointStride + joint;
+		return Cartesian3(rotation[0][index], rotation[1][index], rotation[2][index]);
+		} // Rotation()
+
+	// and scatter it back
+	void SetRotation(int frame, int joint, const Cartesian3& value)
+		{ // SetRotation()
+		size_t index = (size_t) frame * jointStride + joint;
+		rotation[0][index] = value.x;
+		rotation[1][index] = value.y;
+		rotation[2][index] = value.z;
+		} // SetRotation()
+
+	// the start of one component (0 w, 1 x, 2 y, 3 z) of the orientation tracks,
+	// laid out like the rotation tracks
+	float* OrientationTrack(int component) { return orientation[component]; }
+	const float* OrientationTrack(int component) const { return orientation[component]; }
+
+	// gather the orientation of one joint in one frame
+	Quaternion Orientation(int frame, int joint) const
+		{ // Orientation()
+		size_t index = (size_t) frame * jointStride + joint;
+		return Quaternion(orientation[0][index], orientation[1][index], orientation[2][index], orientation[3][index]);
+		} // Orientation()
+
+	// convert the rotations of a frame into normalized quaternions, composed in each joint's channel order
+	void ComputeOrientations(int frame, const std::vector<JointChannels>& layout);
+
+	// the whole buffer, and its size in bytes
+	const float* Data() const { return data; }
+	size_t Bytes() const { return totalFloats * sizeof(float); }
+
+	// whether the buffer is viewed rather than allocated here
+	bool IsView() const { return viewOwner != nullptr; }
+
+	private:
+	// point the track pointers into the buffer
+	void SetupTracks();
+
+	// free the buffer if it is ours, or let go of the view
+	void Release();
+
+	// the single allocation (or view) and its size
+	float* data;
+	size_t totalFloats;
+
+	// whatever keeps a viewed buffer alive, empty if the buffer is ours
+	std::shared_ptr<const void> viewOwner;
+
+	// sizes
+	int frameCount;
+	int jointCount;
+	int channelCount;
+	int channelStride;
+	int jointStride;
+
+	// the start of each track inside data
+	float* channels;
+	float* rotation[3];
+	float* orientation[4];
+	}; // class AnimationTracks
+
+#endif
@@ -0,0 +1,208 @@
+#include "BVHClipFile.h"
+#include "BVHData.h"
+#include "AnimationTracks.h"
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// round a byte offset up to the next section boundary
+static uint64_t AlignUp(uint64_t offset)
+	{ // AlignUp()
+	return (offset + BVHC_ALIGNMENT - 1) & ~(BVHC_ALIGNMENT - 1);
+	} // AlignUp()
+
+// check that [offset, offset + size) lies inside the file
+static bool InFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+	{ // InFile()
+	return offset <= fileSize && size <= fileSize - offset;
+	} // InFile()
+
+// read the size and modification time of a source file, returns false if there is none
+bool StatClipSource(const char* fileName, BVHClipSource& source)
+	{ // StatClipSource()
+	struct stat info;
+	if (stat(fileName, &info) != 0)
+		return false;
+	source.size = info.st_size;
+#if defined(__APPLE__)
+	source.modified = (int64_t) info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+	source.modified = (int64_t) info.st_mtime * 1000000000;
+#else
+	source.modified = (int64_t) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+	return true;
+	} // StatClipSource()
+
+// constructor - starts out empty
+CompiledClip::CompiledClip()
+	: header(nullptr), joints(nullptr), names(nullptr), channelCodes(nullptr), tracks(nullptr)
+	{ // constructor
+	} // constructor
+
+// map and validate a compiled clip, returns false on failure
+bool CompiledClip::Open(const char* fileName)
+	{ // Open()
+	Close();
+	if (!file.Open(fileName))
+		return false;
+
+	// check the header before trusting anything in it
+	if (file.Size() < sizeof(BVHClipHeader))
+		{ Close(); return false; }
+	const BVHClipHeader* h = reinterpret_cast<const BVHClipHeader*>(file.Data());
+	if (memcmp(h->magic, BVHC_MAGIC, 4) != 0 || h->version != BVHC_VERSION || h->endianTag != BVHC_ENDIAN_TAG || h->fileSize != file.Size())
+		{ Close(); return false; }
+
+	// now check that every section fits inside the file
+	bool valid = h->jointCount <= INT32_MAX && h->channelCount <= INT32_MAX && h->frameCount <= INT32_MAX
+		&& InFile(h->jointsOffset, (uint64_t) h->jointCount * sizeof(BVHClipJoint), h->fileSize)
+		&& InFile(h->namesOffset, h->namesSize, h->fileSize)
+		&& InFile(h->channelCodesOffset, h->channelCount, h->fileSize)
+		&& InFile(h->tracksOffset, h->tracksSize, h->fileSize);
+	// and that the tracks are the size AnimationTracks lays them out at (counting one frame
+	// first, as the joint and channel counts are bounded by the file but the frames are not)
+	uint64_t frameBytes = valid ? AnimationTracks::LayoutFloats(1, h->jointCount, h->channelCount) * sizeof(float) : 0;
+	valid = valid && frameBytes != 0 && h->frameCount <= h->fileSize / frameBytes && h->tracksSize == h->frameCount * frameBytes
+		&& h->jointsOffset % BVHC_ALIGNMENT == 0 && h->tracksOffset % BVHC_ALIGNMENT == 0;
+	if (!valid)
+		{ Close(); return false; }
+
+	// set up the section pointers
+	header = h;
+	joints = reinterpret_cast<const BVHClipJoint*>(file.Data() + h->jointsOffset);
+	names = file.Data() + h->namesOffset;
+	channelCodes = reinterpret_cast<const uint8_t*>(file.Data() + h->channelCodesOffset);
+	tracks = reinterpret_cast<const float*>(file.Data() + h->tracksOffset);
+
+	// and check the hierarchy itself, so that accessors never need to: each joint's
+	// channels follow straight on from its parent's, and together they are every channel
+	uint32_t nextChannel = 0;
+	for (uint32_t joint = 0; joint < h->jointCount; joint++)
+		{ // per joint
+		const BVHClipJoint& j = joints[joint];
+		if (j.parent >= (int32_t) joint || j.parent < -1
+			|| (uint64_t) j.nameOffset + j.nameLength > h->namesSize
+			|| j.firstChannel != nextChannel || j.channelCount > h->channelCount - nextChannel)
+			{ Close(); return false; }
+		nextChannel += j.channelCount;
+		} // per joint
+	if (nextChannel != h->channelCount)
+		{ Close(); return false; }
+	for (uint32_t channel = 0; channel < h->channelCount; channel++)
+		if (channelCodes[channel] > 5)
+			{ Close(); return false; }
+
+	return true;
+	} // Open()
+
+// release the mapping
+void CompiledClip::Close()
+	{ // Close()
+	file.Close();
+	header = nullptr;
+	joints = nullptr;
+	names = nullptr;
+	channelCodes = nullptr;
+	tracks = nullptr;
+	} // Close()
+
+// write a loaded clip out in compiled form, returns false on failure
+bool CompiledClip::Write(const BVHData& clip, const char* fileName, const BVHClipSource& source)
+	{ // Write()
+	if (!clip.skeleton)
+		return false;
+	const Skeleton& rig = *clip.skeleton;
+	uint32_t jointCount = rig.JointCount();
+	uint32_t frameCount = clip.tracks.FrameCount();
+	if (jointCount == 0 || (int) frameCount != clip.frame_count || clip.tracks.JointCount() != (int) jointCount)
+		return false;
+
+	// flatten the hierarchy, collecting the names and channel codes as we go
+	std::vector<BVHClipJoint> jointTable(jointCount);
+	std::string nameTable;
+	std::vector<uint8_t> codes;
+	for (uint32_t joint = 0; joint < jointCount; joint++)
+		{ // per joint
+		BVHClipJoint& entry = jointTable[joint];
+		entry.parent = rig.parentBones[joint];
+		entry.nameOffset = nameTable.size();
+		entry.nameLength = rig.Bones[joint].size();
+		entry.firstChannel = codes.size();
+		entry.channelCount = rig.jointChannels[joint].size();
+		for (int axis = 0; axis < 3; axis++)
+			entry.offset[axis] = rig.boneTranslations[joint][axis];
+		nameTable += rig.Bones[joint];
+		for (const std::string& channel : rig.jointChannels[joint])
+			{ // per channel
+			// an unknown channel name cannot be represented
+			int code = ::ChannelCode(channel);
+			if (code < 0)
+				return false;
+			codes.push_back(code);
+			} // per channel
+		} // per joint
+	uint32_t channelCount = codes.size();
+
+	// every frame has to hold exactly one value per channel
+	if (clip.tracks.ChannelCount() != (int) channelCount)
+		return false;
+
+	// lay out the sections
+	BVHClipHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BVHC_MAGIC, 4);
+	header.version = BVHC_VERSION;
+	header.endianTag = BVHC_ENDIAN_TAG;
+	header.jointCount = jointCount;
+	header.channelCount = channelCount;
+	header.frameCount = frameCount;
+	header.frameTime = clip.frame_time;
+	header.sourceSize = source.size;
+	header.sourceModified = source.modified;
+	header.jointsOffset = AlignUp(sizeof(BVHClipHeader));
+	header.namesOffset = AlignUp(header.jointsOffset + jointCount * sizeof(BVHClipJoint));
+	header.namesSize = nameTable.size();
+	header.channelCodesOffset = AlignUp(header.namesOffset + header.namesSize);
+	header.tracksOffset = AlignUp(header.channelCodesOffset + channelCount);
+	header.tracksSize = clip.tracks.Bytes();
+	header.fileSize = header.tracksOffset + header.tracksSize;
+
+	// write to a temporary name first, so that nobody ever maps a half-written file
+	std::string tempName = std::string(fileName) + ".tmp";
+	std::ofstream outFile(tempName, std::ios::binary | std::ios::trunc);
+	if (!outFile)
+		return false;
+
+	// writes a block, padding up to its offset first
+	uint64_t written = 0;
+	auto writeAt = [&](uint64_t offset, const void* data, uint64_t size)
+		{ // writeAt()
+		static const char zeros[BVHC_ALIGNMENT] = { 0 };
+		outFile.write(zeros, offset - written);
+		outFile.write(static_cast<const char*>(data), size);
+		written = offset + size;
+		}; // writeAt()
+
+	writeAt(0, &header, sizeof(header));
+	writeAt(header.jointsOffset, jointTable.data(), jointCount * sizeof(BVHClipJoint));
+	writeAt(header.namesOffset, nameTable.data(), nameTable.size());
+	writeAt(header.channelCodesOffset, codes.data(), codes.size());
+	// the tracks go out in one block, padding and all, so that loading can use them in place
+	// (the orientations included, so that loading never has to rebuild them)
+	writeAt(header.tracksOffset, clip.tracks.Data(), header.tracksSize);
+
+	outFile.close();
+	if (!outFile)
+		{ // failed write
+		std::remove(tempName.c_str());
+		return false;
+		} // failed write
+
+	// and move it into place (POSIX rename replaces the old file atomically)
+#ifdef _WIN32
+	std::remove(fileName);
+#endif
+	return std::rename(tempName.c_str(), fileName) == 0;
+	} // Write()
@@ -0,0 +1,124 @@
+#ifndef _BVH_CLIP_FILE_H
+#define _BVH_CLIP_FILE_H
+
+#include <cstdint>
+#include <string_view>
+#include "Cartesian3.h"
+#include "MappedFile.h"
+
+// forward declaration
+class BVHData;
+
+// compiled clip (.bvhc) file layout
+// everything is native-endian and every section starts on a 64 byte boundary,
+// so a mapped file can be used in place without any parsing or copying
+//
+//	BVHClipHeader
+//	BVHClipJoint[jointCount]			flattened hierarchy, parents before children
+//	char[namesSize]						joint names, not null terminated
+//	uint8_t[channelCount]				channel codes (0-2 position xyz, 3-5 rotation xyz)
+//	float[tracksSize / 4]				the tracks exactly as AnimationTracks lays them out: raw channels,
+//										negated rotations and orientations, every row padded to a cache line
+const char BVHC_MAGIC[4] = { 'B', 'V', 'H', 'C' };
+const uint32_t BVHC_VERSION = 3;
+const uint32_t BVHC_ENDIAN_TAG = 0x01020304;
+const uint64_t BVHC_ALIGNMENT = 64;
+
+// fixed-size header at the start of the file
+struct BVHClipHeader
+	{ // struct BVHClipHeader
+	char magic[4];
+	uint32_t version;
+	uint32_t endianTag;
+	uint32_t jointCount;
+	uint32_t channelCount;
+	uint32_t frameCount;
+	float frameTime;
+	uint32_t reserved;
+	// total size, so that truncated files are caught
+	uint64_t fileSize;
+	// size and modification time (in ns) of the text the clip was compiled from,
+	// so that an edit in the same second as the compile is still caught
+	uint64_t sourceSize;
+	int64_t sourceModified;
+	// byte offsets of each section from the start of the file
+	uint64_t jointsOffset;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+	uint64_t channelCodesOffset;
+	uint64_t tracksOffset;
+	uint64_t tracksSize;
+	}; // struct BVHClipHeader
+
+// the text file a clip is compiled from
+struct BVHClipSource
+	{ // struct BVHClipSource
+	uint64_t size;
+	int64_t modified;
+	}; // struct BVHClipSource
+
+// read the size and modification time of a source file, returns false if there is none
+bool StatClipSource(const char* fileName, BVHClipSource& source);
+
+// one entry per joint in the flattened hierarchy
+struct BVHClipJoint
+	{ // struct BVHClipJoint
+	int32_t parent;
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t firstChannel;
+	uint32_t channelCount;
+	float offset[3];
+	}; // struct BVHClipJoint
+
+// read-only view of a compiled clip file
+// the file is mapped shared, so every process that opens the same clip
+// uses the same physical pages
+class CompiledClip
+	{ // class CompiledClip
+	public:
+	// constructor - starts out empty
+	CompiledClip();
+
+	// map and validate a compiled clip, returns false on failure
+	bool Open(const char* fileName);
+
+	// release the mapping
+	void Close();
+
+	// write a loaded clip out in compiled form, returns false on failure
+	static bool Write(const BVHData& clip, const char* fileName, const BVHClipSource& source);
+
+	// sizes
+	int JointCount() const { return header->jointCount; }
+	int ChannelCount() const { return header->channelCount; }
+	int FrameCount() const { return header->frameCount; }
+	float FrameTime() const { return header->frameTime; }
+
+	// hierarchy
+	int JointParent(int joint) const { return joints[joint].parent; }
+	std::string_view JointName(int joint) const { return std::string_view(names + joints[joint].nameOffset, joints[joint].nameLength); }
+	Cartesian3 JointOffset(int joint) const { return Cartesian3(joints[joint].offset[0], joints[joint].offset[1], joints[joint].offset[2]); }
+	int JointFirstChannel(int joint) const { return joints[joint].firstChannel; }
+	int JointChannelCount(int joint) const { return joints[joint].channelCount; }
+	int ChannelCode(int channel) const { return channelCodes[channel]; }
+
+	// whether the clip was compiled from the source as it is now
+	bool CompiledFrom(const BVHClipSource& source) const { return header->sourceSize == source.size && header->sourceModified == source.modified; }
+
+	// the tracks, straight out of the mapped pages, for AnimationTracks::View
+	const float* Tracks() const { return tracks; }
+
+	private:
+	// the mapped file
+	MappedFile file;
+
+	// pointers to each section inside the mapping
+	const BVHClipHeader* header;
+	const BVHClipJoint* joints;
+	const char* names;
+	const uint8_t* channelCodes;
+	const float* tracks;
+	}; // class CompiledClip
+
+#endif
@@ -1,406 +1,663 @@
 #include "BVHData.h"
+#include "MappedFile.h"
+#include "BVHClipFile.h"
+#include "BVHStream.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 // constructor
 BVHData::BVHData()
 	{ // constructor
-	isTransitioningBack = true;
-	m_AnimState = Running;
-	m_currentState = Running;
 	} // constructor
 	
 // read data from bvh file
 // a basic recursive-descent parser
-bool BVHData::ReadFileBVH(const char* fileName)
+// the file is memory-mapped and tokenised in place, so no line or token is ever copied
+bool BVHData::ReadFileBVH(const char* fileName, const RoleMap& roles)
 	{ // ReadFileBVH()
-	// open a file stream and check validity
-	std::ifstream inFile(fileName);
-	if (inFile.bad())
+	// any cached poses and cubics belong to the old data
+	ClearPoseCache();
+	cubicTracks.clear();
+	// map the file and check validity
+	MappedFile file;
+	if (!file.Open(fileName))
 		return false;
 
-	// temporary storage to read in a single line
-	std::string line;
+	// walk the mapped text one line at a time
+	BVHTokenizer tokenizer(file.Data(), file.End());
 	// a vector of the tokens on the line
-	std::vector<std::string> tokens;
+	std::vector<std::string_view> tokens;
+	// a clip needs both sections
+	bool foundHierarchy = false;
+	bool foundMotion = false;
 	
 	// loop through the file one line at a time
-	while (std::getline(inFile, line))
+	while (tokenizer.NextLine(tokens))
 		{ // more lines in the file
-		// not an empty line
-		if (line.size() != 0)
-			{ // non-empty line
-			// chop the line into tokens
-			StringSplit(line, tokens);
-
-			// if the first token is HIERARCHY, it is the logical structure of the character
-			if (tokens[0] == "HIERARCHY")
-				{ // hierarchy
-				// read in a line and split it into tokens
-				NewLine(inFile, tokens);
-				// create a joint object 
-				Joint joint;
-				// read in the hierarchy based at the joint
-				ReadHierarchy(inFile, tokens, joint, -1);
-				// and set it to be the root
-				this->root = joint;
-				} // hierarchy
-			// otherwise, if the first token is MOTION, it is the animation data
-			else if (tokens[0] == "MOTION")
-				{ // motion
-				ReadMotion(inFile);
-				break;
-				} // motion
-			else
-				{ // otherwise
-				// ignore everything els
-				} // otherwise
-			} // non-empty line
+		// if the first token is HIERARCHY, it is the logical structure of the character
+		if (tokens[0] == "HIERARCHY")
+			{ // hierarchy
+			// read in a line and split it into tokens
+			tokenizer.NextLine(tokens);
+			// read in the hierarchy based at the root
+			if (!ReadHierarchy(tokenizer, tokens, roles))
+				return false;
+			foundHierarchy = true;
+			} // hierarchy
+		// otherwise, if the first token is MOTION, it is the animation data
+		else if (tokens[0] == "MOTION")
+			{ // motion
+			if (!ReadMotion(tokenizer))
+				return false;
+			foundMotion = true;
+			break;
+			} // motion
+		else
+			{ // otherwise
+			// ignore everything els
+			} // otherwise
 		} // more lines in the file
+	if (!foundHierarchy || !foundMotion)
+		return false;
 
-	// do a recursive search to set up the vector of pointers to the joints
-	GetAllJoints(this->root, this->all_joints);
-	// load all rotation and translation data into this class
-	loadAllData(this->boneRotations, this->boneTranslations, this->frames);
+	// load all rotation data into this class
+	loadAllData();
 	return true;
 	} // ReadFileBVH()
 
-// read a single line and tokenise it
-void BVHData::NewLine(std::ifstream& inFile, std::vector<std::string>& tokens)
-	{ // NewLine()
-	// the next line
-	std::string line;
-	// empty out the array of tokens
-	tokens.clear();
-	// read in the line
-	std::getline(inFile, line);
-	// and split it into tokens
-	StringSplit(line, tokens);
-	} // NewLine()
-
-// split string with the given key character
-void BVHData::StringSplit(std::string input, std::vector<std::string>& tokens)
-	{ // StringSplit()
-	// empty out the array of tokens
-	tokens.clear();
-	// create a local string stream for tokenising
-	std::istringstream iss(input);
-	while (!iss.eof()) 
-		{ // more tokens to come
-		// create a token
-		std::string token;
-		// read it in
-		iss >> token;
-		// and add it to the vector
-		tokens.push_back(token);
-		} // more tokens to come
-	} // StringSplit()
-
-// check whether the given string is a number
-bool BVHData::isNumeric(const std::string& str) 
-	{ // isNumeric()
-	// loop through the characters in the string
-	for (char c : str) 
-		// if it's not a digit, return early
-		if (!std::isdigit(c)) 
-			return false;
-	// return success
-	return true;
-	} // isNumeric()
-
-// recursive descent parser for the hierarchy
-void BVHData::ReadHierarchy(std::ifstream& inFile, std::vector<std::string>& line, Joint& joint, int parent)
+// read the hierarchy into a skeleton, sharing it with other clips on the same rig
+bool BVHData::ReadHierarchy(BVHTokenizer& tokenizer, std::vector<std::string_view>& line, const RoleMap& roles)
 	{ // ReadHierarchy()
-	// the new joint will have the next available ID 
-	// (0 offset means that it will be equal to the existing size)
-	joint.id = this->Bones.size();
-	// the second token (#1) will be the name of the joint
-	joint.joint_name = line[1];
-	// add the name to the list
-	this->Bones.push_back(joint.joint_name);
-	// and set the parent bone
-	this->parentBones.push_back(parent);
-	// this seems redundant, but removing it crashes. This works. For now.
-	int id = this->parentBones.size() - 1;
-	// read in the next line & tokenise it
-	NewLine(inFile, line);
-	// if the beginning of the line is a left brace, we're starting a group of children
-	if (line[0] == "{")
-		{ // group of children
-		// ignore the rest of the line and read in a new one
-		NewLine(inFile, line);
-		while (line[0] != "}")
-			{ // until we hit the close of the group
-			// The first token tells us which type of line
-			// OFFSET is the offset from the parent
-			if (line[0] == "OFFSET")
-				{
-				joint.joint_offset[0] = std::stof(line[1]);
-				joint.joint_offset[1] = std::stof(line[2]);
-				joint.joint_offset[2] = std::stof(line[3]);
-				}
-			// CHANNELS defines how many floats are needed for the animation, and which ones
-			else if (line[0] == "CHANNELS")
-				{ // channel information
-				for (int i = 0; i < std::stoi(line[1]); i++)
-					joint.joint_channel.push_back(line[i + 2]);
-				} // channel information
-			// JOINT defines a new joint
-			else if (line[0] == "JOINT")
-				{ // joint information
-				Joint child;
-				ReadHierarchy(inFile, line, child, id);
-				joint.Children.push_back(child);
-				} // joint information 
-			// At the leaf of the hierarchy, there is no joint. Instead it says End 
-			else if (line[0] == "End")
-				{ // end site
-				// read in and ignore three extra lines
-				for (int i = 0; i < 3; i++) 
-					NewLine(inFile, line);
-				} // end site
-			// always read the next line when done processing this line
-			NewLine(inFile, line);
-			} // until we hit the close of the group
-		} // group of children
+	std::shared_ptr<Skeleton> rig = std::make_shared<Skeleton>();
+	if (line.size() < 2 || !rig->ReadHierarchy(tokenizer, line, -1))
+		return false;
+	rig->Finish(roles);
+	this->skeleton = Skeleton::Share(rig);
+	return true;
 	} // ReadHierarchy()
 
-// read motion(frames) from file
-void BVHData::ReadMotion(std::ifstream& inFile)
-	{ // ReadMotion()
-	// a single line from the file
-	std::string line;
-	// and the tokens it breaks into
-	std::vector<std::string> tokens;
+// read the frame count and frame time at the start of the MOTION block
+bool BVHData::ReadMotionHeader(BVHTokenizer& tokenizer)
+	{ // ReadMotionHeader()
+	// the tokens each line breaks into
+	std::vector<std::string_view> tokens;
 	// the next line should specify how many frames, so read it in
-	NewLine(inFile, tokens);
-	// convert to an integer and save
-	this->frame_count = std::stoi(tokens[1]);
+	// and convert to an integer and save
+	if (!tokenizer.NextLine(tokens) || tokens.size() < 2 || !BVHTokenizer::ParseInt(tokens[1], this->frame_count))
+		return false;
 	// the next line should specify how many seconds per frame, so read it in
-	NewLine(inFile, tokens);
 	// and convert it to a float
-	this->frame_time = std::stof(tokens[2]);
-	// after that, we loop until the end of the file
-	while (std::getline(inFile, line))
+	if (!tokenizer.NextLine(tokens) || tokens.size() < 3 || !BVHTokenizer::ParseFloat(tokens[2], this->frame_time))
+		return false;
+	return true;
+	} // ReadMotionHeader()
+
+// decode one line-aligned chunk of the MOTION block into consecutive frames of the tracks
+static bool DecodeMotionChunk(const char* begin, const char* end, AnimationTracks& tracks, int frame)
+	{ // DecodeMotionChunk()
+	BVHTokenizer tokenizer(begin, end);
+	// the tokens each line breaks into
+	std::vector<std::string_view> tokens;
+	while (tokenizer.NextLine(tokens))
 		{ // more data
-		// ignore empty lines
-		if (line.size() != 0)
-			{ // non-empty line
-			// split the line into tokens
-			StringSplit(line, tokens);
-			// create a vector to store all the animation data for the frame
-			std::vector<float> frame;
-			// loop through the line, one token at a time
-			for (size_t i = 0; i < tokens.size(); i++)
-				{ // per token
-				if (!isNumeric(tokens[i]))
-					{ // if it's not numeric
-					frame.push_back(std::stof(tokens[i]));
-					} // if it's not numeric
-				} // per token
-			// store frame into this class
-			this->frames.push_back(frame);
-			}
+		if (!BVHTokenizer::ParseFrame(tokens, tracks.FrameChannels(frame), tracks.ChannelCount()))
+			return false;
+		// and move on to the next frame
+		frame++;
 		} // more data
+	return true;
+	} // DecodeMotionChunk()
+
+// read motion(frames) from file
+// the frame lines are split into line-aligned chunks which are decoded in parallel,
+// each chunk writing straight into its own range of the preallocated tracks
+bool BVHData::ReadMotion(BVHTokenizer& tokenizer)
+	{ // ReadMotion()
+	// frame count and frame time come first, and the hierarchy must already be known
+	if (!this->skeleton || !ReadMotionHeader(tokenizer))
+		return false;
+
+	// everything after that is frame data
+	const char* motionStart = tokenizer.Position();
+	const char* motionEnd = tokenizer.End();
+	size_t motionSize = motionEnd - motionStart;
+
+	// work out how many threads are worth using: small clips stay on this thread
+	size_t nThreads = decodeThreads;
+	if (nThreads == 0)
+		nThreads = std::max(1u, std::thread::hardware_concurrency());
+	nThreads = std::max<size_t>(1, std::min(nThreads, motionSize / MOTION_CHUNK_MIN_BYTES));
+
+	// split the text into chunks that each start at the beginning of a line
+	std::vector<const char*> chunkStart(nThreads + 1, motionEnd);
+	chunkStart[0] = motionStart;
+	for (size_t chunk = 1; chunk < nThreads; chunk++)
+		{ // per chunk boundary
+		const char* split = std::max(chunkStart[chunk - 1], motionStart + chunk * (motionSize / nThreads));
+		const char* newline = static_cast<const char*>(memchr(split, '\n', motionEnd - split));
+		chunkStart[chunk] = newline ? newline + 1 : motionEnd;
+		} // per chunk boundary
+
+	// runs the given job once per chunk, on worker threads when there is more than one
+	auto forEachChunk = [&](auto job)
+		{ // forEachChunk()
+		if (nThreads == 1)
+			{ // serial
+			job(0);
+			return;
+			} // serial
+		std::vector<std::thread> workers;
+		workers.reserve(nThreads);
+		for (size_t chunk = 0; chunk < nThreads; chunk++)
+			workers.emplace_back(job, chunk);
+		for (std::thread& worker : workers)
+			worker.join();
+		}; // forEachChunk()
+
+	// first pass: count the frames in each chunk so we know where each one writes
+	std::vector<size_t> firstFrame(nThreads + 1, 0);
+	forEachChunk([&](size_t chunk)
+		{ // count frames
+		firstFrame[chunk + 1] = BVHTokenizer::CountLines(chunkStart[chunk], chunkStart[chunk + 1]);
+		}); // count frames
+	for (size_t chunk = 0; chunk < nThreads; chunk++)
+		firstFrame[chunk + 1] += firstFrame[chunk];
+
+	// second pass: decode every chunk into its slice of the tracks
+	this->tracks.Resize(firstFrame[nThreads], this->skeleton->JointCount(), this->skeleton->CountChannels());
+	std::vector<char> decoded(nThreads, 0);
+	forEachChunk([&](size_t chunk)
+		{ // decode frames
+		decoded[chunk] = DecodeMotionChunk(chunkStart[chunk], chunkStart[chunk + 1], this->tracks, firstFrame[chunk]);
+		}); // decode frames
+
+	// we have consumed the rest of the file
+	tokenizer = BVHTokenizer(motionEnd, motionEnd);
+	if (std::find(decoded.begin(), decoded.end(), 0) != decoded.end())
+		return false;
+	// the header must agree with the frames actually there, or frame_count would
+	// index past the tracks (a truncated file) or hide frames (a bad header)
+	return this->tracks.FrameCount() == this->frame_count;
 	} // ReadMotion()
 
+// read a compiled (.bvhc) clip written by CompiledClip::Write, if a source is given
+// only if the clip was compiled from it as it is now
+bool BVHData::ReadFileBVHC(const char* fileName, const RoleMap& roles, const BVHClipSource* source)
+	{ // ReadFileBVHC()
+	// any cached poses and cubics belong to the old data
+	ClearPoseCache();
+	cubicTracks.clear();
+	std::shared_ptr<CompiledClip> mapped = std::make_shared<CompiledClip>();
+	if (!mapped->Open(fileName) || (source != nullptr && !mapped->CompiledFrom(*source)))
+		return false;
+	const CompiledClip& clip = *mapped;
+
+	// rebuild the hierarchy, which is stored parents first just as we keep it
+	std::shared_ptr<Skeleton> rig = std::make_shared<Skeleton>();
+	for (int joint = 0; joint < clip.JointCount(); joint++)
+		{ // per joint
+		rig->AddJoint(clip.JointName(joint), clip.JointParent(joint), clip.JointOffset(joint));
+		for (int channel = 0; channel < clip.JointChannelCount(joint); channel++)
+			rig->jointChannels[joint].push_back(CHANNEL_NAMES[clip.ChannelCode(clip.JointFirstChannel(joint) + channel)]);
+		} // per joint
+	rig->Finish(roles);
+	this->skeleton = Skeleton::Share(rig);
+
+	// the tracks are already decoded, negated, turned into quaternions and padded,
+	// so they are used where they are mapped, and keep the mapping alive
+	this->frame_count = clip.FrameCount();
+	this->frame_time = clip.FrameTime();
+	this->tracks.View(clip.Tracks(), clip.FrameCount(), clip.JointCount(), clip.ChannelCount(), mapped);
+	return true;
+	} // ReadFileBVHC()
+
+// load a clip through its compiled cache: the .bvhc next to the .bvh is used
+// if it is up to date, otherwise the text is parsed and the cache rewritten
+// if a rig is given, the clip must have the same topology and then plays on that rig
+bool BVHData::LoadClip(const char* fileName, const SkeletonHandle& rig, const RoleMap& roles)
+	{ // LoadClip()
+	std::string compiledName = std::string(fileName) + "c";
+
+	// use the compiled version if it was compiled from the text as it is now
+	BVHClipSource source = { 0, 0 };
+	bool haveText = StatClipSource(fileName, source);
+	bool loaded = ReadFileBVHC(compiledName.c_str(), roles, haveText ? &source : nullptr);
+
+	// otherwise fall back to the text, and refresh the cache for next time
+	if (!loaded)
+		{ // text clip
+		if (!ReadFileBVH(fileName, roles))
+			return false;
+		if (!CompiledClip::Write(*this, compiledName.c_str(), source))
+			std::cout << "Unable to write compiled clip " << compiledName << std::endl;
+		} // text clip
+
+	// a clip for a given rig has to match it joint for joint
+	if (rig)
+		{ // check rig
+		if (!this->skeleton || !this->skeleton->SameTopology(*rig))
+			{ // wrong rig
+			std::cout << fileName << " does not match the skeleton it is played on" << std::endl;
+			return false;
+			} // wrong rig
+		this->skeleton = rig;
+		} // check rig
+	return true;
+	} // LoadClip()
+
+// load a clip as for LoadClip, into a shared read-only handle (empty on failure)
+ClipHandle BVHData::Load(const char* fileName, const SkeletonHandle& rig, bool cubic, const RoleMap& roles)
+	{ // Load()
+	std::shared_ptr<BVHData> clip = std::make_shared<BVHData>();
+	if (!clip->LoadClip(fileName, rig, roles))
+		return ClipHandle();
+	if (cubic)
+		clip->BuildCubicTracks();
+	return clip;
+	} // Load()
+
+// open a clip for streaming: the hierarchy is read now, but frames are only decoded
+// on demand into a window of the given size, so long clips never sit in memory
+bool BVHData::OpenStream(const char* fileName, int windowFrames, const RoleMap& roles)
+	{ // OpenStream()
+	// sampling between two frames needs both in the window at once
+	if (windowFrames < STREAM_MIN_WINDOW_FRAMES)
+		return false;
+	// any cached poses and cubics belong to the old data
+	ClearPoseCache();
+	cubicTracks.clear();
+	std::shared_ptr<BVHStream> newStream = std::make_shared<BVHStream>();
+	if (!newStream->Open(fileName))
+		return false;
+
+	BVHTokenizer tokenizer(newStream->Data(), newStream->End());
+	std::vector<std::string_view> tokens;
+	bool foundMotion = false;
+	while (!foundMotion && tokenizer.NextLine(tokens))
+		{ // more lines in the file
+		// the hierarchy is parsed exactly as for a full load
+		if (tokens[0] == "HIERARCHY")
+			{ // hierarchy
+			tokenizer.NextLine(tokens);
+			if (!ReadHierarchy(tokenizer, tokens, roles))
+				return false;
+			} // hierarchy
+		// but for the motion we only want the header
+		else if (tokens[0] == "MOTION")
+			{ // motion
+			if (!ReadMotionHeader(tokenizer))
+				return false;
+			foundMotion = true;
+			} // motion
+		} // more lines in the file
+	if (!foundMotion || !this->skeleton)
+		return false;
+
+	// and hand the rest of the file to the stream
+	newStream->Begin(tokenizer.Position(), this->skeleton->channelMap, windowFrames);
+	this->stream = newStream;
+	return true;
+	} // OpenStream()
+
 // Negate the rotations in the rotations array
 void BVHData::NegateRotations()
 {
-	for(int i = 0; i < frame_count; i++)
+	// each axis is one contiguous track, padding included
+	size_t trackSize = (size_t) tracks.FrameCount() * tracks.JointStride();
+	for(int axis = 0; axis < 3; axis++)
 	{
-		for(int j = 0; j < all_joints.size(); j++)
-		{
-			boneRotations[i][j] = -boneRotations[i][j];
-		}
+		float* track = tracks.RotationTrack(axis);
+		for(size_t i = 0; i < trackSize; i++)
+			track[i] = -track[i];
 	}
 }
 
-std::pair<Quaternion, Cartesian3> BVHData::BlendPose(Cartesian3& a, Cartesian3& b, double time, float slerpAmount, Cartesian3& currentPos, Cartesian3& other)
+Cartesian3 BVHData::SampleAnimation(int frame, int jointID) const
 {
-	// Animation A rotation
-	Quaternion a_rotX = Quaternion(a.x, Cartesian3(1.0f, 0.0f, 0.0f).unit()); a_rotX.Normalize();
-	Quaternion a_rotY = Quaternion(a.y, Cartesian3(0.0f, 1.0f, 0.0f).unit()); a_rotY.Normalize();
-	Quaternion a_rotZ = Quaternion(a.z, Cartesian3(0.0f, 0.0f, 1.0f).unit()); a_rotZ.Normalize();
-	Quaternion a_animARotQuat = (a_rotZ * a_rotY) * a_rotX;
-
-	// Animation B rotation
-	Quaternion b_rotX = Quaternion(b.x, Cartesian3(1.0f, 0.0f, 0.0f).unit()); b_rotX.Normalize();
-	Quaternion b_rotY = Quaternion(b.y, Cartesian3(0.0f, 1.0f, 0.0f).unit()); b_rotY.Normalize();
-	Quaternion b_rotZ = Quaternion(b.z, Cartesian3(0.0f, 0.0f, 1.0f).unit()); b_rotZ.Normalize();
-	Quaternion b_animARotQuat = (b_rotZ * b_rotY) * b_rotX;
-
-	// Check how we're going to lerp
-	double amount_to_lerp = isTransitioningBack ? 1.0 - (time / slerpAmount) : time / slerpAmount;
-
-	if(isTransitioningBack)
-	{
-		if(amount_to_lerp <= 0.0)
-		{
-			amount_to_lerp = 0.0f;
-			m_AnimState = Running;
-			m_currentState = Running;
-			isTransitioningBack = false;	
-			transitionTo.clear();
-		}
-	} else 
+	// streamed clips play out of the decoded window
+	if(stream)
 	{
-		if(amount_to_lerp > 1.0)
-		{
-			amount_to_lerp = 1.0f;
-		}
+		if(!stream->Fetch(frame))
+			return Cartesian3(0.0f, 0.0f, 0.0f);
+		return stream->Rotation(frame, jointID);
 	}
-
-	Quaternion blendedRot = Slerp(a_animARotQuat, b_animARotQuat, amount_to_lerp);
-	Cartesian3 blendedPos = Lerp(currentPos, other, amount_to_lerp);
-	
-	return {blendedRot, blendedPos};
+	return tracks.Rotation(frame, jointID);
 }
 
-std::pair<Quaternion, Cartesian3> BVHData::CalculateNewPose(int frame, float time, float slerpAmount, int jointID)
+// where the four orientation rows (w, x, y, z) of a frame start, in the tracks or the stream window
+bool BVHData::OrientationRows(int frame, const float* rows[4]) const
 {
-	// Set up pose for animation A and B
-	auto f = (frame + 1) % frame_count;
-	Cartesian3 anim_pose_A = SampleAnimation(f, jointID);
-	Cartesian3 anim_pose_B = SampleAnimation(f, jointID);
-	// if there is a transition animation clip to transition to, set rotation to the animation clips rotation
-	// at this current frame 
-	Cartesian3 other;
-	if(!transitionTo.empty())
-	{
-		// Get the first animation clip and sample animation to get current joint pose transforms
-		BVHData transitionAnim = transitionTo[transitionTo.size() - 1];
-		auto sampleFrame = (frame + 1) % transitionAnim.frame_count;
-		anim_pose_B = transitionTo[transitionTo.size() - 1].SampleAnimation(sampleFrame, jointID);
-
-		other = transitionTo[transitionTo.size() - 1].SamplePosition(sampleFrame, jointID);
-		if(m_AnimState == TurnLeft || m_AnimState == TurnRight)
-		{
-			if(sampleFrame == (transitionAnim.frame_count - 1) && jointID == 64)
-			{
-				// isTransitioningBack = true;
-				//transitionTo.clear();
-			}
-		}
-	}
-
-	Cartesian3 currentPosition = SampleAnimation(f, jointID);
-	// Blend the poses
-	std::pair<Quaternion, Cartesian3> blendedPose = BlendPose(anim_pose_A, anim_pose_B, time, slerpAmount, currentPosition, other);
-	return blendedPose;
+	if(stream)
+		return stream->OrientationRows(frame, rows);
+	if(frame < 0 || frame >= tracks.FrameCount())
+		return false;
+	for(int component = 0; component < 4; component++)
+		rows[component] = tracks.OrientationTrack(component) + (size_t) frame * tracks.JointStride();
+	return true;
 }
 
-Cartesian3 BVHData::SampleAnimation(int frame, int jointID)
+Cartesian3 BVHData::SamplePosition(int frame, int jointID) const
 {
-	return boneRotations[frame][jointID];
-}
+	const JointChannels& layout = skeleton->channelMap[jointID];
 
-Cartesian3 BVHData::SamplePosition(int frame, int jointID)
-{
-	auto joint = all_joints[jointID];
+	// streamed clips play out of the decoded window
+	if(stream && !stream->Fetch(frame))
+		return Cartesian3(0.0f, 0.0f, 0.0f);
+	const float* channels = stream ? stream->FrameChannels(frame) : tracks.FrameChannels(frame);
 
+	// each position channel the joint has is read from its own slot in the frame
 	Cartesian3 position = Cartesian3(0.0f, 0.0f, 0.0f);
-	for(int i = 0; i < joint->joint_channel.size(); i++)
-    {
-        const std::string& channel = joint->joint_channel[i];
-        float value = frames[frame][BVH_CHANNEL[channel]];
-		// if the channel is for x position, set the x position
-        if(channel == "Xposition")
-        {
-			position.x = value;
-        }
-		// if the channel is for y position, set the y position
-        if(channel == "Yposition")
-        {
-           position.y = value;
-        }
-		// if the channel is for z position, set the z position
-        if(channel == "Zposition")
-        {
-            position.z = value;
-        }
+	for(int axis = 0; axis < 3; axis++)
+	{
+		if(layout.positionMask & (1 << axis))
+			position[axis] = channels[layout.position[axis]];
 	}
 
 	return position;
 }
 
-// render hierarchy for a given frame
-void BVHData::Render(Matrix4& viewMatrix, float scale, int frame, double time,  Cartesian3& playerpos, Cartesian3& dir, Matrix4& playerTransform)
+// render a frame of the animation (wrapping round the clip)
+void BVHData::Render(Matrix4& viewMatrix, float scale, int frame)
 { // Render()
-	RenderJoint(viewMatrix, Matrix4::Identity(), &this->root, scale, frame, playerpos, dir, playerTransform);
+	if(frame_count <= 0)
+		return;
+	// build the pose cache the first time round (and give up for good if the clip cannot be cached)
+	if(cachePoses && CachedPose(0, scale) == nullptr)
+		cachePoses = BuildPoseCache(scale);
+	blendInputs.assign(1, BlendInput{ this, frame % frame_count, 1.0f });
+	Render(viewMatrix, scale, blendInputs);
+} // Render()
+
+// render a blend of clips on this clip's rig, with any layers over it
+// the global matrices are kept from the last frame, so only the subtrees under
+// joints whose local matrix changed are composed again
+void BVHData::Render(Matrix4& viewMatrix, float scale, const std::vector<BlendInput>& inputs, const std::vector<PoseLayer>& layers)
+{ // Render()
+	// an unblended clip on a frame plays straight out of its pose cache, if it has one
+	if(inputs.size() == 1 && layers.empty() && inputs[0].clip != nullptr
+		&& (inputs[0].fraction <= 0.0f || sampleMode == SAMPLE_STEP))
+	{
+		const Affine3* cached = inputs[0].clip->CachedPose(inputs[0].frame, scale);
+		if(cached != nullptr)
+		{
+			jointsComposed = 0;
+			DrawPose(viewMatrix, cached);
+			return;
+		}
+	}
+
+	// blend the rotations, then pose the rig with them as EvaluatePose does,
+	// running only the joints that changed down the hierarchy
+	blender.Evaluate(inputs, blendAccuracy, sampleMode);
+	for(const PoseLayer& layer : layers)
+		blender.ApplyLayer(layer, blendAccuracy);
+	jointsComposed = EvaluatePose(blender, scale, composer);
+	DrawPose(viewMatrix, composer.Globals());
 } // Render()
 
-static int cycles = 0;
-// render a single joint for a given frame
-void BVHData::RenderJoint(Matrix4& viewMatrix, Matrix4 parentMatrix, Joint* joint, float scale, int frame, Cartesian3& playerpos, Cartesian3& dir, Matrix4& playerTransform)
-	{ // RenderJoint()
-
-	// Time since animation started
-	auto currentTime = std::chrono::high_resolution_clock::now();
-	double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(currentTime - timeStart).count();
-	double time_in_seconds = nanoseconds / 1e+9;
-
-	auto f = (frame + 1) % frame_count;
-
-	// Determine updated pose for current joint
-	std::pair<Quaternion, Cartesian3> updatedPose = CalculateNewPose(frame, time_in_seconds, 0.5f, joint->id);
-	Matrix4 finalRotationMatrix = updatedPose.first.ToRotationMatrix();
-
-	Homogeneous4 offset_from_parent = Homogeneous4(joint->joint_offset[0] * scale, joint->joint_offset[1] * scale, joint->joint_offset[2] * scale, 1.0f);
-
-    if(joint->joint_name == "mixamorig1:Hips")
-    {
-        // offset_from_parent.x = playerpos.x + updatedPose.second.x;
-        // offset_from_parent.z = playerpos.z + updatedPose.second.z;
-        // when turn animation completes, its removed to playerpos becomes previous animations transform which is at 0,29,0     
-        auto previous = playerpos;
-        if(m_AnimState == TurnLeft || m_AnimState == TurnRight)
-        {
-            if(!transitionTo.empty())
-            {
-                auto BVH = transitionTo[transitionTo.size() - 1];
-                if((BVH.frame_count - 1) == ((frame + 1) % BVH.frame_count))
-                {
-                    auto a = BVH.SampleAnimation((frame + 1) % BVH.frame_count, joint->id);
-                    Quaternion a_rotY = Quaternion(a.y, Cartesian3(0.0f, 1.0f, 0.0f).unit()); 
-        
-                    //std::cout << "MOVE BACK: " << playerpos <<  " Rot: " << a.y << std::endl;
-                    
-                    // playerpos = Cartesian3(0,0,0);
-                    std::cout << "player pos: " << playerpos << std::endl; 
-                    dir.Rotate(a.y, Cartesian3(0.0f, 1.0f, 0.0f));
-                    dir = dir.unit();   
-                    // playerpos = offset_from_parent.Point();
-                    // std::cout << "direction: " << dir << std::endl;                  
-                }
-            }
-        }
-        
-    }
-
-
-	auto Offset = Matrix4::Translate({offset_from_parent.x, offset_from_parent.y, offset_from_parent.z});
-
-	auto global = Matrix4::Identity();
-	global = parentMatrix * Offset * finalRotationMatrix;
-
-	// multiply offset by parent matrix to get it into the correct space to render
-	offset_from_parent = parentMatrix * offset_from_parent;
-
-	// for each child of the current joint, recursively render the joint
-	// using start and end position
-	for(auto& child : joint->Children)
+// draw the bone from each joint's parent to the joint, all in one call
+void BVHData::DrawPose(Matrix4& viewMatrix, const Affine3* global)
+{ // DrawPose()
+	const Skeleton& rig = *skeleton;
+	boneBatch.Begin(BONE_SLICES);
+	for(int joint = 0; joint < rig.JointCount(); joint++)
 	{
-        auto end = global * Homogeneous4(child.joint_offset[0] * scale, child.joint_offset[1]* scale, child.joint_offset[2]* scale, 1.0f);
-		auto endpoint = end.Point();
-		auto start = offset_from_parent.Point();
-		RenderCylinder(viewMatrix, start, endpoint, finalRotationMatrix, joint->joint_name);
-        // Recursively render the child joint
-        RenderJoint(viewMatrix, global, &child, scale, frame, playerpos, dir, playerTransform);
+		int parent = rig.parentBones[joint];
+		if(parent < 0)
+			continue;
+		Cartesian3 start = global[parent].Translation();
+		Cartesian3 end = global[joint].Translation();
+		RenderCylinder(viewMatrix, start, end);
+	}
+	boneBatch.Draw();
+} // DrawPose()
+
+// the local and global (model space) matrix of every joint at a frame, with no blending
+// and no GL: both arrays are supplied by the caller and hold skeleton->JointCount()
+// matrices, and nothing is allocated
+void BVHData::EvaluatePose(int frame, float scale, Affine3* local, Affine3* global) const
+{ // EvaluatePose()
+	// one sweep along the orientation rows of the frame (or the rest pose, if it cannot be had)
+	const Skeleton& rig = *skeleton;
+	const float* rows[4];
+	bool sampled = OrientationRows(frame, rows);
+	for(int joint = 0; joint < rig.JointCount(); joint++)
+		local[joint] = JointLocal(sampled ? rows : nullptr, scale, joint);
+	rig.ComposePose(local, global);
+} // EvaluatePose()
+
+// the same at a time in seconds, sampled between frames as sampleMode says
+bool BVHData::EvaluatePoseAtTime(double time, float scale, PoseBlender& pose, Affine3* local, Affine3* global) const
+{ // EvaluatePoseAtTime()
+	if(frame_count <= 0)
+		return false;
+	double position = FramePosition(time);
+	int frame = std::min((int) position, frame_count - 1);
+	BlendInput input = { this, frame, 1.0f, (float) (position - frame) };
+	if(!pose.Evaluate(&input, 1, blendAccuracy, sampleMode))
+		return false;
+	EvaluatePose(pose, scale, local, global);
+	return true;
+} // EvaluatePoseAtTime()
+
+// the local matrix of a joint, from four rows of orientations (w, x, y, z) indexed by joint,
+// or at rest without them
+Affine3 BVHData::JointLocal(const float* const rows[4], float scale, int joint) const
+{ // JointLocal()
+	Quaternion rotation = (rows != nullptr) ? Quaternion(rows[0][joint], rows[1][joint], rows[2][joint], rows[3][joint])
+		: Quaternion(1.0f, 0.0f, 0.0f, 0.0f);
+	return Affine3::Rigid(rotation, skeleton->boneTranslations[joint] * scale);
+} // JointLocal()
+
+// the same for a blended pose on this clip's rig
+void BVHData::EvaluatePose(const PoseBlender& pose, float scale, Affine3* local, Affine3* global) const
+{ // EvaluatePose()
+	// one sweep along the rows of the blended pose, if it covers the rig
+	const Skeleton& rig = *skeleton;
+	const float* rows[4] = { pose.Orientation(0), pose.Orientation(1), pose.Orientation(2), pose.Orientation(3) };
+	bool covered = pose.JointCount() == rig.JointCount();
+	for(int joint = 0; joint < rig.JointCount(); joint++)
+		local[joint] = JointLocal(covered ? rows : nullptr, scale, joint);
+	rig.ComposePose(local, global);
+} // EvaluatePose()
+
+// and into a composer, which recomposes only the joints whose local matrix changed
+int BVHData::EvaluatePose(const PoseBlender& pose, float scale, PoseComposer& composer) const
+{ // EvaluatePose()
+	// only set up the first time round
+	if(composer.Rig() != skeleton)
+		composer.SetRig(skeleton);
+	const float* rows[4] = { pose.Orientation(0), pose.Orientation(1), pose.Orientation(2), pose.Orientation(3) };
+	bool covered = pose.JointCount() == skeleton->JointCount();
+	for(int joint = 0; joint < skeleton->JointCount(); joint++)
+		composer.SetLocal(joint, JointLocal(covered ? rows : nullptr, scale, joint));
+	return composer.Update();
+} // EvaluatePose()
+
+// the frame playing at a time in seconds, wrapping round the clip
+int BVHData::FrameAtTime(double time) const
+{ // FrameAtTime()
+	int frame = (int) std::floor(FramePosition(time));
+	// rounding can put a position just short of the end onto it
+	return (frame >= frame_count) ? 0 : frame;
+} // FrameAtTime()
+
+// the same to a fraction of a frame
+double BVHData::FramePosition(double time) const
+{ // FramePosition()
+	if(frame_count <= 0 || frame_time <= 0.0f)
+		return 0.0;
+	double position = std::fmod(time / frame_time, (double) frame_count);
+	return (position < 0.0) ? position + frame_count : position;
+} // FramePosition()
+
+// the orientation of every joint part way from a frame to the next one
+bool BVHData::SampleOrientations(int frame, float fraction, SampleMode mode, BlendAccuracy accuracy, float* const rows[4]) const
+{ // SampleOrientations()
+	if(!skeleton || frame_count <= 0)
+		return false;
+	int jointCount = skeleton->JointCount();
+	const float* from[4];
+	const float* to[4];
+	int next = (frame + 1) % frame_count;
+	// streamed clips only decode forward, so they hold the frame rather than wrap round
+	if(stream && next < frame)
+		fraction = 0.0f;
+
+	if(fraction > 0.0f && mode == SAMPLE_CUBIC && !cubicTracks.empty() && frame >= 0 && frame < frame_count
+		&& OrientationRows(frame, from) && OrientationRows(next, to))
+	{
+		// the Hermite cubic from the keys and their tangents, the next key (and its tangent)
+		// taking the shorter way round; then back onto the unit sphere
+		float t2 = fraction * fraction;
+		float t3 = t2 * fraction;
+		float fromKeyWeight = 2.0f * t3 - 3.0f * t2 + 1.0f;
+		float fromSlopeWeight = t3 - 2.0f * t2 + fraction;
+		float toKeyWeight = 3.0f * t2 - 2.0f * t3;
+		float toSlopeWeight = t3 - t2;
+		size_t stride = tracks.JointStride();
+		const float* fromTangent = cubicTracks.data() + (size_t) frame * 5 * stride;
+		const float* toTangent = cubicTracks.data() + (size_t) next * 5 * stride;
+		const float* side = fromTangent + 4 * stride;
+		for(int component = 0; component < 4; component++)
+		{
+			const float* fromKey = from[component];
+			const float* toKey = to[component];
+			const float* fromSlope = fromTangent + component * stride;
+			const float* toSlope = toTangent + component * stride;
+			float* out = rows[component];
+			for(int joint = 0; joint < jointCount; joint++)
+				out[joint] = fromKeyWeight * fromKey[joint] + fromSlopeWeight * fromSlope[joint]
+					+ side[joint] * (toKeyWeight * toKey[joint] + toSlopeWeight * toSlope[joint]);
+		}
+		for(int joint = 0; joint < jointCount; joint++)
+		{
+			float norm = rows[0][joint] * rows[0][joint] + rows[1][joint] * rows[1][joint]
+				+ rows[2][joint] * rows[2][joint] + rows[3][joint] * rows[3][joint];
+			float scale = 1.0f / std::sqrt(norm);
+			for(int component = 0; component < 4; component++)
+				rows[component][joint] *= scale;
+		}
+		return true;
 	}
 
-} // RenderJoint()
+	if(fraction > 0.0f && mode != SAMPLE_STEP)
+	{
+		// the next frame first, so that a stream's window still holds this one afterwards
+		if(!OrientationRows(next, to) || !OrientationRows(frame, from))
+			return false;
+		BlendQuaternions(from, to, fraction, rows, jointCount, accuracy);
+		return true;
+	}
 
-// render cylinder given the start position and the end position
-void BVHData::RenderCylinder(Matrix4& viewMatrix, Cartesian3 start, Cartesian3 end, const Matrix4& a, const std::string& name)
+	if(!OrientationRows(frame, from))
+		return false;
+	for(int component = 0; component < 4; component++)
+		std::copy(from[component], from[component] + jointCount, rows[component]);
+	return true;
+} // SampleOrientations()
+
+// compose every frame into the pose cache at the given scale, on several threads
+// returns false (leaving no cache) for streamed clips or if it would exceed the budget
+bool BVHData::BuildPoseCache(float scale)
+	{ // BuildPoseCache()
+	ClearPoseCache();
+	// streamed clips decode on demand, which is neither cacheable nor thread-safe
+	if (stream || !skeleton || tracks.FrameCount() == 0)
+		return false;
+	size_t jointCount = skeleton->JointCount();
+	size_t frames = tracks.FrameCount();
+	if (frames * jointCount * sizeof(Affine3) > poseCacheBudget)
+		return false;
+	poseCache.resize(frames * jointCount);
+
+	// split the frames evenly, each thread with its own local transforms
+	size_t nThreads = decodeThreads;
+	if (nThreads == 0)
+		nThreads = std::max(1u, std::thread::hardware_concurrency());
+	nThreads = std::min(nThreads, frames);
+	auto composeFrames = [&](size_t thread)
+		{ // composeFrames()
+		std::vector<Affine3> local(jointCount);
+		for (size_t frame = thread * frames / nThreads; frame < (thread + 1) * frames / nThreads; frame++)
+			EvaluatePose(frame, scale, local.data(), poseCache.data() + frame * jointCount);
+		}; // composeFrames()
+	if (nThreads == 1)
+		composeFrames(0);
+	else
+		{ // parallel
+		std::vector<std::thread> workers;
+		workers.reserve(nThreads);
+		for (size_t thread = 0; thread < nThreads; thread++)
+			workers.emplace_back(composeFrames, thread);
+		for (std::thread& worker : workers)
+			worker.join();
+		} // parallel
+
+	poseCacheScale = scale;
+	return true;
+	} // BuildPoseCache()
+
+// the cached global transforms of a frame, or null if there is no cache at this scale
+const Affine3* BVHData::CachedPose(int frame, float scale) const
+	{ // CachedPose()
+	if (poseCache.empty() || scale != poseCacheScale || frame < 0 || frame >= tracks.FrameCount())
+		return nullptr;
+	return poseCache.data() + (size_t) frame * skeleton->JointCount();
+	} // CachedPose()
+
+// drop the pose cache
+void BVHData::ClearPoseCache()
+	{ // ClearPoseCache()
+	poseCache.clear();
+	poseCache.shrink_to_fit();
+	poseCacheScale = 0.0f;
+	} // ClearPoseCache()
+
+// precompute the cubic coefficients of every frame to the next
+// each span is a Catmull-Rom spline through the frames either side, wrapping round the clip,
+// as a cubic in the fraction, so sampling it is three multiply-adds per component
+bool BVHData::BuildCubicTracks()
+	{ // BuildCubicTracks()
+	cubicTracks.clear();
+	if (stream || !skeleton || tracks.FrameCount() == 0)
+		return false;
+	int frames = tracks.FrameCount();
+	int jointCount = skeleton->JointCount();
+	size_t stride = tracks.JointStride();
+	cubicTracks.assign((size_t) frames * 5 * stride, 0.0f);
+
+	for (int frame = 0; frame < frames; frame++)
+		{ // per key
+		const float* before[4];
+		const float* key[4];
+		const float* after[4];
+		OrientationRows((frame - 1 + frames) % frames, before);
+		OrientationRows(frame, key);
+		OrientationRows((frame + 1) % frames, after);
+		float* tangent = cubicTracks.data() + (size_t) frame * 5 * stride;
+		for (int joint = 0; joint < jointCount; joint++)
+			{ // per joint
+			// the keys either side take the shorter way round from this one
+			float beforeDot = 0.0f, afterDot = 0.0f;
+			for (int component = 0; component < 4; component++)
+				{ // per component
+				beforeDot += before[component][joint] * key[component][joint];
+				afterDot += after[component][joint] * key[component][joint];
+				} // per component
+			float beforeSide = (beforeDot < 0.0f) ? -1.0f : 1.0f;
+			float afterSide = (afterDot < 0.0f) ? -1.0f : 1.0f;
+			for (int component = 0; component < 4; component++)
+				tangent[component * stride + joint] = 0.5f * (afterSide * after[component][joint] - beforeSide * before[component][joint]);
+			tangent[4 * stride + joint] = afterSide;
+			} // per joint
+		} // per key
+	return true;
+	} // BuildCubicTracks()
+
+// add the cylinder from the start position to the end position to the bones being drawn
+void BVHData::RenderCylinder(Matrix4& viewMatrix, Cartesian3 start, Cartesian3 end)
 	{ // RenderCylinder()
 
 	// Calculate the difference between the two points
@@ -411,153 +668,50 @@ void BVHData::RenderCylinder(Matrix4& viewMatrix, Cartesian3 start, Cartesian3 e
 
 	// Normalize the difference vector to get the direction
     Cartesian3 dir = diff.unit();
-	const GLfloat boneCol[4] = {0.0, 0.0, 0.0, 1.0};
-
-	// Render skeleton using lines
-	if(false)
-	{
-		auto viewStart = viewMatrix * start;
-		auto viewEnd = viewMatrix * end;
-		glLineWidth(10.0f);
-		glColor3f(1.0, 0.0f, 0.0f);
-		glBegin(GL_LINES);
-		glVertex3f(viewStart.x, viewStart.y, viewStart.z);
-		glVertex3f(viewEnd.x, viewEnd.y, viewEnd.z);
-		glEnd();
-	}
 
-	
-	if(name == "mixamorig1:Hips")
-	{
-		auto vs = viewMatrix * start;
-		//drawMatrix(a, viewMatrix, vs);
-	}
-	
 	// set up the transformations for the cylinder
-	auto cyTranslate = Matrix4::Translate({start.x, start.y, start.z});
-	auto cyMatrix = viewMatrix * cyTranslate * Matrix4::RotateDirection(dir); 
+	// translating after the rotation only fills in the last column
+	Affine3 cylinder = Affine3::RotateDirection(dir);
+	cylinder.SetTranslation(start);
+	auto cyMatrix = viewMatrix * cylinder;
 
-	Cylinder(cyMatrix, 1.0, length, 10);
+	if(boneRenderer != nullptr && boneRenderer->Ready())
+		boneRenderer->AddCylinder(cyMatrix, 1.0f, length);
+	else
+		boneBatch.AddCylinder(cyMatrix, 1.0f, length);
 
 	} // RenderCylinder()
 
-// render a single cylinder given radius, length and vertical slices
-void BVHData::Cylinder(Matrix4& viewMatrix, float radius, float Length, int slices)
-	{  // Cylinder()
-	// start a set of triangles
-	glBegin(GL_TRIANGLES);
-	// loop through the given number of slices
-	for (int i = 0; i < slices; i++) 
-		{ // per slice
-		// work out the angles around the main axis for the start and end of the slice
-		float theta = (float)(i * 2.0f * M_PI / slices);
-		float nextTheta = (float)((i + 1) * 2.0f * M_PI / slices);
-		float midTheta = 0.5 * (theta + nextTheta);
-
-		// the top vertex is always in the same place
-		Homogeneous4 center_up = viewMatrix * Homogeneous4(0.0, 0.0, Length, 1);
-		// we have two points on the upper circle of the cylinder
-		Homogeneous4 c_edge1 = viewMatrix * Homogeneous4(radius * cos(theta), radius * sin(theta), Length, 1);
-		Homogeneous4 c_edge2 = viewMatrix * Homogeneous4(radius * cos(nextTheta), radius * sin(nextTheta), Length, 1);
-		// and two points on the bottom circle
-		Homogeneous4 c_edge3 = viewMatrix * Homogeneous4(radius * cos(nextTheta), radius * sin(nextTheta), 0, 1);
-		Homogeneous4 c_edge4 = viewMatrix * Homogeneous4(radius * cos(theta), radius * sin(theta), 0, 1);
-		// and a point in the middle of the bottom
-		Homogeneous4 center_bottom = viewMatrix * Homogeneous4(0.0, 0.0, 0, 1);
-
-		// normal vectors are tricky because we need to AVOID using the translation
-		// We can either use a triangle face normal, or we can do a hack ;-)
-		// because we know that they are from the origin to given points
-
-		// we have three normals: one for the top
-		Cartesian3 normal_up = viewMatrix * Cartesian3(0, 0, 1.0) - viewMatrix * Cartesian3(0.0, 0.0, 0.0);
-		// one for the middle
-		Cartesian3 normal_edge = viewMatrix * Cartesian3(cos(midTheta), sin(midTheta), 0.0) - viewMatrix * Cartesian3(0.0, 0.0, 0.0);
-		// and one for the bottom
-		Cartesian3 normal_bottom = viewMatrix * Cartesian3(0, 0, -1.0) - viewMatrix * Cartesian3(0.0, 0.0, 0.0);
-
-		// render the top triangle
-		glNormal3fv(&normal_up.x);
-		glVertex4fv(&center_up.x);
-		glVertex4fv(&c_edge1.x);
-		glVertex4fv(&c_edge2.x);
-
-		// and the side triangles
-		glNormal3fv(&normal_edge.x);
-		glVertex4fv(&c_edge2.x);
-		glVertex4fv(&c_edge1.x);
-		glVertex4fv(&c_edge4.x);
-
-		glNormal3fv(&normal_edge.x);
-		glVertex4fv(&c_edge2.x);
-		glVertex4fv(&c_edge4.x);
-		glVertex4fv(&c_edge3.x);
-
-		// and the bottom triangle
-		glNormal3fv(&normal_bottom.x);
-		glVertex4fv(&c_edge3.x);
-		glVertex4fv(&c_edge4.x);
-		glVertex4fv(&center_bottom.x);
-
-		}
-	glEnd();
-	} // Cylinder()
-
-// get all joints in a sequence by searching the tree structure and store it into this class
-void BVHData::GetAllJoints(Joint& joint, std::vector<Joint*>& joint_list)
-	{ // GetAllJoints()
-	// it's recursive, so push the current one
-	joint_list.push_back(&joint);
-	// base case: end site, so return
-	if (joint.Children.size() == 0)
-		return;
-	// otherwise, loop through the children
-	for (size_t i = 0; i < joint.Children.size(); i++)
-		// adding them recursively
-		GetAllJoints(joint.Children[i], joint_list);
-	} // GetAllJoints()
-
-// load all rotation and translation data into this class
-void BVHData::loadAllData(std::vector<std::vector<Cartesian3>>& rotations, std::vector<Cartesian3>& translations, std::vector<std::vector<float>>& frames)
+// load all rotation data into this class
+// (the offsets/translations belong to the skeleton)
+void BVHData::loadAllData()
 	{ // loadAllData()
 	// store all rotations
-	for (size_t i = 0; i < frames.size(); i++)
-		{ // per frame 
-		std::vector<Cartesian3> frame_rotations;
-		loadRotationData(frame_rotations, frames[i]);
-		rotations.push_back(frame_rotations);
-		} // per frame
-	// store all offsets/translations
-	for (size_t i = 0; i < this->all_joints.size(); i++)
-		{ // per joint
-		float x = this->all_joints[i]->joint_offset[0];
-		float y = this->all_joints[i]->joint_offset[1];
-		float z = this->all_joints[i]->joint_offset[2];
-		translations.push_back(Cartesian3(x, y, z));
-		} // per joint
+	for (int i = 0; i < this->tracks.FrameCount(); i++)
+		loadRotationData(i);
 
 	NegateRotations();
 
+	// and turn them into quaternions once, rather than on every sample
+	for (int i = 0; i < this->tracks.FrameCount(); i++)
+		this->tracks.ComputeOrientations(i, this->skeleton->channelMap);
+
 	} // loadAllData()
 
-// load all rotation data into this class
-void BVHData::loadRotationData(std::vector<Cartesian3>& rotations, std::vector<float>& frames)
+// fill the rotation tracks of one frame from its raw channels
+void BVHData::loadRotationData(int frame)
 	{ // loadRotationData()
-	for (size_t j = 0, j_c = 0; j < frames.size(); j_c++)
-		{ // per frame
+	const float* channels = this->tracks.FrameChannels(frame);
+	const std::vector<JointChannels>& channelMap = this->skeleton->channelMap;
+	for (size_t joint = 0; joint < channelMap.size(); joint++)
+		{ // per joint
+		const JointChannels& layout = channelMap[joint];
+		// axes without a rotation channel stay at zero
 		float rotation[3] = { 0, 0, 0 };
-		for (size_t k = 0; k < this->all_joints[j_c]->joint_channel.size(); k++) // for each channel
-			{ // per channel
-			// if the channel includes "rotation" in the name
-			if (this->all_joints[j_c]->joint_channel[k].substr(1) == "rotation")
-				{ // rotation channel
-				int rotation_id = BVH_CHANNEL[this->all_joints[j_c]->joint_channel[k]];
-				rotation[rotation_id - 3] = frames[j + k];
-				} // rotation channel
-			} // per channel
+		for (int axis = 0; axis < 3; axis++)
+			if (layout.rotation[axis] >= 0)
+				rotation[axis] = channels[layout.rotation[axis]];
 		// convert to a rotation
-		Cartesian3 rot_3(rotation[0], rotation[1], rotation[2]);
-		rotations.push_back(rot_3);
-		j += this->all_joints[j_c]->joint_channel.size();
-		} // per frame
+		this->tracks.SetRotation(frame, joint, Cartesian3(rotation[0], rotation[1], rotation[2]));
+		} // per joint
 	} // loadRotationData()
@@ -16,52 +16,46 @@
 
 #include <vector>
 #include <string>
-#include <sstream>
+#include <string_view>
 #include "Cartesian3.h"
 #include "Matrix4.h"
-#include <fstream>
+#include "Affine3.h"
+#include "BVHTokenizer.h"
 #include <map>
 #include <math.h>
 #include "Quaternion.h"
-#include <queue>
-#include <chrono>
+#include <memory>
+#include "BVHStream.h"
+#include "AnimationTracks.h"
+#include "PoseBlend.h"
+#include "BlendTree.h"
+#include "Skeleton.h"
+#include "PoseComposer.h"
+#include "BoneMesh.h"
+#include "BoneRenderer.h"
 
 
-enum CharacterState
-{
-	Running,
-	TurnLeft,
-	TurnRight,
-	Idle,
-	UNSET
-};
+// MOTION blocks smaller than this (per thread) are not worth splitting up
+const size_t MOTION_CHUNK_MIN_BYTES = 256 * 1024;
 
+// default limit on the size of one clip's pose cache
+const size_t POSE_CACHE_BUDGET_BYTES = 8 * 1024 * 1024;
 
-// A class for each joint
-class Joint
-	{ // class Joint
-	public:
-	// joint id
-	int id;
-	// joint name
-	std::string joint_name;
-	// joint offset
-	float joint_offset[3] = {0.0f, 0.0f, 0.0f};
-	// joint channel
-	std::vector<std::string> joint_channel;
-	// joint's children
-	std::vector<Joint> Children;
-	}; // class Joint
-	// array of pointers
+// the text file a compiled clip was made from (BVHClipFile.h)
+struct BVHClipSource;
 
+// clips are loaded once and then shared read-only by everything that plays them
+class BVHData;
+typedef std::shared_ptr<const BVHData> ClipHandle;
 
 // bvh data class
 class BVHData
 	{ // class BVHData
 	public:
 
-	// the root joint of armature
-	Joint root;
+	// the rig: hierarchy, names, offsets and channel layout,
+	// shared by every clip recorded on it
+	SkeletonHandle skeleton;
 
 	// bvh frame count
 	int frame_count;
@@ -69,108 +63,181 @@ class BVHData
 	// frame rate of the animation
 	float frame_time;
 
-	// a vector to store all bones' name
-	std::vector<std::string> Bones;
-
-	// a vector to store all joints
-	std::vector<Joint*> all_joints;
+	// all frames of the animation, in one contiguous block:
+	// the raw channel values of each frame, in strict numerical order,
+	// and the (negated) rotation of every joint, one track per axis
+	AnimationTracks tracks;
 
-	// a vector to store the parent bone's id for each joint
-	std::vector<int> parentBones;
+	// when the clip is streamed, the tracks stay empty
+	// and samples come out of the stream's window instead
+	std::shared_ptr<BVHStream> stream;
 
-	double time;
+	// number of threads used to decode the MOTION block (0 means one per core)
+	unsigned decodeThreads = 0;
 
-	// a vector to store all frames of the animation
-	// this is *JUST* a huge 2D array of floats
-	// in each frame, we have six channels for position and rotation for each joint
-	// listed in strict numerical order
-	// Stores position data for only hip joint
-	std::vector<std::vector<float>> frames;
+	// how accurately poses are blended when rendering a blend
+	BlendAccuracy blendAccuracy = BLEND_EXACT;
 
-	// a vector to store all bones' offsets
-	std::vector<Cartesian3> boneTranslations;
+	// optional cache of the global transform of every joint at every frame, so that
+	// an unblended cyclic clip plays back with no FK at all: BuildPoseCache fills it
+	// at load, or Render does on first use if cachePoses is set
+	bool cachePoses = false;
+	// clips whose cache would be bigger than this are not cached
+	size_t poseCacheBudget = POSE_CACHE_BUDGET_BYTES;
 
-	// a vector to store all bones' rotations for each frame
-	std::vector<std::vector<Cartesian3>> boneRotations;
+	// if set (and ready), Render hands its bones to this, to be drawn with every other
+	// character's in one instanced call, rather than drawing them itself
+	BoneRenderer* boneRenderer = nullptr;
 
-	std::vector<BVHData> transitionTo;
+	// how the clips in a blend are sampled between frames, when the time falls between them
+	SampleMode sampleMode = SAMPLE_LINEAR;
 
-	CharacterState m_AnimState;
-	CharacterState m_currentState;
-
-	Cartesian3 perframepos;
-	
-private:
-	// id for each channel
-	std::map<std::string, int> BVH_CHANNEL =
-		{ // BVH_CHANNEL
-			{"Xposition", 0},
-			{"Yposition", 1},
-			{"Zposition", 2},
-			{"Xrotation", 3},
-			{"Yrotation", 4},
-			{"Zrotation", 5}
-		}; // BVH_CHANNEL
-
-public:	
 	// constructor
 	BVHData();
 
-	// render bvh animation by given a sequence of frames data
-	void Render(Matrix4& viewMatrix, float scale, int frame, double time, Cartesian3& playerpos, Cartesian3& dir, Matrix4& playerTransform);
-
-	// render a single joint by given frame id
-	void RenderJoint(Matrix4& viewMatrix, Matrix4 HierarchicalMatrix, Joint* joint, float scale, int frame, Cartesian3& playerpos, Cartesian3& dir, Matrix4& playerTransform);
+	// render a frame of the animation (wrapping round the clip)
+	void Render(Matrix4& viewMatrix, float scale, int frame);
 
-	// render cylinder given the start position and the end position
-	void RenderCylinder(Matrix4& viewMatrix, Cartesian3 start, Cartesian3 end, const Matrix4& a, const std::string& name);
+	// render a blend of clips on this clip's rig, e.g. from a state machine,
+	// with any layers applied over it in order
+	// a single clip with no layers plays straight out of its pose cache, if it has one
+	void Render(Matrix4& viewMatrix, float scale, const std::vector<BlendInput>& inputs,
+		const std::vector<PoseLayer>& layers = std::vector<PoseLayer>());
 
-	// render a single cylinder given radius, length and vertical slices
-	void Cylinder(Matrix4& viewMatrix, float radius, float halfLength, int slices);
-
-	// get all joints in a sequence by searching the tree structure and store it into this class
-	void GetAllJoints(Joint&, std::vector<Joint*>&);
+	// add the cylinder from the start position to the end position to the bones being drawn
+	void RenderCylinder(Matrix4& viewMatrix, Cartesian3 start, Cartesian3 end);
 
 	// Routines for file I/O
+	// each reader resolves the roles of the joints of a new rig through a retarget map,
+	// before the rig is shared with other clips
+
 	// read data from bvh file
-	bool ReadFileBVH(const char* fileName);
+	// fails unless there is a HIERARCHY and a MOTION section
+	bool ReadFileBVH(const char* fileName, const RoleMap& roles = DEFAULT_ROLE_MAP);
 
-	// read a single line and tokenise it
-	void NewLine(std::ifstream&, std::vector<std::string>&);
+	// read the hierarchy into a skeleton, sharing it with other clips on the same rig
+	bool ReadHierarchy(BVHTokenizer&, std::vector<std::string_view>&, const RoleMap& roles = DEFAULT_ROLE_MAP);
 
-	// split string with the given key character
-	void StringSplit(std::string, std::vector<std::string>&);
+	// read motion(frames) from file
+	// fails if the frame lines do not match the Frames: count in the header
+	bool ReadMotion(BVHTokenizer&);
 
-	// recursive descent parser for the hierarchy
-	void ReadHierarchy(std::ifstream&, std::vector<std::string>&, Joint&, int parent);
+	// read a compiled (.bvhc) clip written by CompiledClip::Write, its tracks used in place
+	// if a source is given, only if the clip was compiled from it as it is now
+	bool ReadFileBVHC(const char* fileName, const RoleMap& roles = DEFAULT_ROLE_MAP, const BVHClipSource* source = nullptr);
 
-	// read motion(frames) from file
-	void ReadMotion(std::ifstream&);
+	// open a clip for streaming: the hierarchy is read now, but frames are only decoded
+	// on demand into a window of the given size, so long clips never sit in memory
+	// the window must hold at least two frames, the pair that sampling blends
+	bool OpenStream(const char* fileName, int windowFrames = STREAM_WINDOW_FRAMES, const RoleMap& roles = DEFAULT_ROLE_MAP);
 
-	// load all rotation and translation data into this class
-	void loadAllData(std::vector<std::vector<Cartesian3>>& rotations, std::vector<Cartesian3>& translations, std::vector<std::vector<float>>& frames);
+	// read the frame count and frame time at the start of the MOTION block
+	bool ReadMotionHeader(BVHTokenizer&);
+
+	// load a clip through its compiled cache: the .bvhc next to the .bvh is used
+	// if it is up to date, otherwise the text is parsed and the cache rewritten
+	// if a rig is given, the clip must have the same topology and then plays on that rig
+	// (with that rig's roles); otherwise its roles are resolved through the retarget map
+	bool LoadClip(const char* fileName, const SkeletonHandle& rig = SkeletonHandle(), const RoleMap& roles = DEFAULT_ROLE_MAP);
+
+	// load a clip as for LoadClip, into a shared read-only handle (empty on failure),
+	// with its cubic tangents if it is to be sampled with SAMPLE_CUBIC
+	static ClipHandle Load(const char* fileName, const SkeletonHandle& rig = SkeletonHandle(), bool cubic = false,
+		const RoleMap& roles = DEFAULT_ROLE_MAP);
 
 	// load all rotation data into this class
-	void loadRotationData(std::vector<Cartesian3> &rotations, std::vector<float>& frames);
+	void loadAllData();
 
-	// check whether the given string is a number
-	bool isNumeric(const std::string&);
+	// fill the rotation tracks of one frame from its raw channels
+	void loadRotationData(int frame);
 
-	Cartesian3 SamplePosition(int frame, int jointID);
+	Cartesian3 SamplePosition(int frame, int jointID) const;
 
-	std::chrono::time_point<std::chrono::high_resolution_clock> timeStart;
+	// the local and global (model space) matrix of every joint at a frame, with no blending
+	// and no GL: both arrays are supplied by the caller and hold skeleton->JointCount()
+	// matrices, and nothing is allocated
+	void EvaluatePose(int frame, float scale, Affine3* local, Affine3* global) const;
 
-	void NegateRotations();
+	// the same at a time in seconds, wrapping round the clip and sampled between frames as
+	// sampleMode says; the rotations are sampled into pose, which is reused from call to call
+	// returns false (writing nothing) if the clip has no frames
+	bool EvaluatePoseAtTime(double time, float scale, PoseBlender& pose, Affine3* local, Affine3* global) const;
 
-	float previousRotation;
+	// the same for a blended pose on this clip's rig (at rest if it does not cover the rig)
+	void EvaluatePose(const PoseBlender& pose, float scale, Affine3* local, Affine3* global) const;
 
-	bool isFinished = true;
+	// and into a composer, which recomposes only the joints whose local matrix changed
+	// since the last time, returning how many that was (this is how Render poses the rig)
+	int EvaluatePose(const PoseBlender& pose, float scale, PoseComposer& composer) const;
+
+	// the frame playing at a time in seconds, wrapping round the clip
+	int FrameAtTime(double time) const;
+
+	// the same to a fraction of a frame, from 0 up to (but not including) frame_count
+	double FramePosition(double time) const;
+
+	// the orientation of every joint part way (0 to 1) from a frame to the next one, wrapping
+	// round the clip, into four rows of skeleton->JointCount() floats supplied by the caller
+	// streamed clips hold their last frame rather than wrap round
+	bool SampleOrientations(int frame, float fraction, SampleMode mode, BlendAccuracy accuracy,
+		float* const rows[4]) const;
+
+	// precompute the tangent of the cubic at every key, for SAMPLE_CUBIC
+	// returns false (leaving none) for streamed clips
+	bool BuildCubicTracks();
+
+	// whether the cubic tangents are there, and the memory they hold in bytes
+	bool HasCubicTracks() const { return !cubicTracks.empty(); }
+	size_t CubicTrackBytes() const { return cubicTracks.size() * sizeof(float); }
+
+	// compose every frame into the pose cache at the given scale, on several threads
+	// returns false (leaving no cache) for streamed clips or if it would exceed the budget
+	bool BuildPoseCache(float scale);
+
+	// the cached global transforms of a frame (skeleton->JointCount() of them),
+	// or null if there is no cache at this scale
+	const Affine3* CachedPose(int frame, float scale) const;
+
+	// memory held by the pose cache in bytes
+	size_t PoseCacheBytes() const { return poseCache.size() * sizeof(Affine3); }
+
+	// drop the pose cache
+	void ClearPoseCache();
+
+	// how many joints the last Render had to compose (0 when it played from the pose cache)
+	int JointsComposed() const { return jointsComposed; }
+
+	// where the four orientation rows (w, x, y, z) of a frame start, in the tracks or the stream window
+	bool OrientationRows(int frame, const float* rows[4]) const;
+
+	void NegateRotations();
 
-	bool isTransitioningBack;
+	// the (negated) rotation of a joint at a frame, in degrees about each axis
+	Cartesian3 SampleAnimation(int frame, int jointID) const;
 private:	
-	std::pair<Quaternion, Cartesian3> BlendPose(Cartesian3& a, Cartesian3& b, double time, float slerpAmount, Cartesian3& currentPos, Cartesian3& other);
-	Cartesian3 SampleAnimation(int frame, int jointID);
-	std::pair<Quaternion, Cartesian3> CalculateNewPose(int frame, float time, float slerpAmount, int jointID);
+	// the local and global matrix of each joint drawn by Render, kept from frame to frame
+	// so that only the joints whose local matrix changed are composed again
+	PoseComposer composer;
+	// the local matrix of a joint, from four rows of orientations indexed by joint, or at rest without them
+	Affine3 JointLocal(const float* const rows[4], float scale, int joint) const;
+	int jointsComposed = 0;
+	// the global matrix of each joint drawn by Render, as one batch of bones
+	void DrawPose(Matrix4& viewMatrix, const Affine3* global);
+	BoneBatch boneBatch;
+	// scratch space for blended poses, and the inputs going into them
+	PoseBlender blender;
+	std::vector<BlendInput> blendInputs;
+
+	// the pose cache: frame_count rows of one global transform per joint, and its scale
+	std::vector<Affine3> poseCache;
+	float poseCacheScale = 0.0f;
+
+	// the tangent of the cubic at each key (Catmull-Rom, half the difference of the keys either
+	// side): per frame, five rows of JointStride() floats, the components w, x, y, z of the tangent
+	// and then the side of the next key (1 or -1, whichever is the shorter way round)
+	// the cubic from a key to the next is built from the two keys and their tangents when sampled,
+	// which costs a few multiplies and takes under a third of the memory of storing its coefficients
+	std::vector<float> cubicTracks;
 };
 
 
@@ -0,0 +1,139 @@
+#include "BVHStream.h"
+#include "BVHTokenizer.h"
+#include <algorithm>
+#include <cstring>
+
+// constructor - starts out empty
+BVHStream::BVHStream()
+	: motionStart(nullptr), cursor(nullptr), discarded(nullptr), nextFrame(0), windowStart(0), windowFrames(1)
+	{ // constructor
+	} // constructor
+
+// map the file, returns false on failure
+bool BVHStream::Open(const char* fileName)
+	{ // Open()
+	if (!file.Open(fileName))
+		return false;
+	// we walk the frames front to back, so let the OS read ahead
+	file.AdviseSequential();
+	return true;
+	} // Open()
+
+// start streaming frames from the given position in the text
+// the channel map gives the layout needed to pull out the rotations
+void BVHStream::Begin(const char* start, const std::vector<JointChannels>& channelMap, int window)
+	{ // Begin()
+	motionStart = start;
+	windowFrames = std::max(STREAM_MIN_WINDOW_FRAMES, window);
+
+	layout = channelMap;
+	int nChannels = layout.empty() ? 0 : layout.back().firstChannel + layout.back().channelCount;
+
+	// allocate the ring up front, so that decoding never allocates
+	ring.Resize(windowFrames, layout.size(), nChannels);
+
+	Rewind();
+	} // Begin()
+
+// make sure a frame is in the window, decoding forward (or rewinding) as needed
+// returns false if the frame is past the end of the file or cannot be decoded
+bool BVHStream::Fetch(int frame)
+	{ // Fetch()
+	if (frame < 0)
+		return false;
+	// already decoded
+	if (frame >= windowStart && frame < nextFrame)
+		return true;
+	// frames behind the window are gone, so start again from the top
+	if (frame < windowStart)
+		Rewind();
+	// frames that would fall out of the window before we reach the target are skipped
+	while (nextFrame < frame - windowFrames + 1)
+		if (!SkipNext())
+			return false;
+	// and the rest are decoded into the ring
+	while (nextFrame <= frame)
+		if (!DecodeNext())
+			return false;
+	DiscardBehind();
+	return true;
+	} // Fetch()
+
+// fetch a frame and point at its four orientation rows (w, x, y, z), returns false on failure
+bool BVHStream::OrientationRows(int frame, const float* rows[4])
+	{ // OrientationRows()
+	if (!Fetch(frame))
+		return false;
+	for (int component = 0; component < 4; component++)
+		rows[component] = ring.OrientationTrack(component) + (size_t) (frame % windowFrames) * ring.JointStride();
+	return true;
+	} // OrientationRows()
+
+// go back to the first frame
+void BVHStream::Rewind()
+	{ // Rewind()
+	cursor = motionStart;
+	discarded = motionStart;
+	nextFrame = 0;
+	windowStart = 0;
+	} // Rewind()
+
+// decode the next line of text into the slot for nextFrame
+bool BVHStream::DecodeNext()
+	{ // DecodeNext()
+	// tokenise just the next non-empty line
+	BVHTokenizer tokenizer(cursor, file.End());
+	if (!tokenizer.NextLine(tokens))
+		return false;
+	int slot = nextFrame % windowFrames;
+	float* values = ring.FrameChannels(slot);
+	if (!BVHTokenizer::ParseFrame(tokens, values, ring.ChannelCount()))
+		return false;
+	cursor = tokenizer.Position();
+
+	// pull out the rotations and negate them, exactly as loadAllData does
+	for (int axis = 0; axis < 3; axis++)
+		{ // per axis
+		float* track = ring.RotationTrack(axis) + (size_t) slot * ring.JointStride();
+		for (int joint = 0; joint < ring.JointCount(); joint++)
+			{ // per joint
+			int channel = layout[joint].rotation[axis];
+			track[joint] = (channel >= 0) ? -values[channel] : -0.0f;
+			} // per joint
+		} // per axis
+	ring.ComputeOrientations(slot, layout);
+
+	nextFrame++;
+	windowStart = std::max(windowStart, nextFrame - windowFrames);
+	return true;
+	} // DecodeNext()
+
+// skip the next line of text without decoding it
+bool BVHStream::SkipNext()
+	{ // SkipNext()
+	// find the next line that has something on it
+	while (cursor < file.End())
+		{ // per line
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', file.End() - cursor));
+		if (lineEnd == nullptr)
+			lineEnd = file.End();
+		bool blank = BVHTokenizer::CountLines(cursor, lineEnd) == 0;
+		cursor = (lineEnd < file.End()) ? lineEnd + 1 : lineEnd;
+		if (!blank)
+			{ // skipped a frame
+			nextFrame++;
+			windowStart = nextFrame;
+			return true;
+			} // skipped a frame
+		} // per line
+	return false;
+	} // SkipNext()
+
+// give the text we have already read back to the OS
+void BVHStream::DiscardBehind()
+	{ // DiscardBehind()
+	if ((size_t) (cursor - discarded) < STREAM_DISCARD_BYTES)
+		return;
+	file.Discard(discarded, cursor);
+	discarded = cursor;
+	} // DiscardBehind()
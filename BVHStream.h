@@ -0,0 +1,97 @@
+#ifndef _BVH_STREAM_H
+#define _BVH_STREAM_H
+
+#include <string_view>
+#include <vector>
+#include "Cartesian3.h"
+#include "MappedFile.h"
+#include "AnimationTracks.h"
+#include "JointChannels.h"
+
+// default number of decoded frames kept in memory by a stream
+const int STREAM_WINDOW_FRAMES = 64;
+
+// the smallest window: a frame and the next, for sampling between them
+const int STREAM_MIN_WINDOW_FRAMES = 2;
+
+// the text behind the cursor is given back to the OS in blocks of this size
+const size_t STREAM_DISCARD_BYTES = 4 * 1024 * 1024;
+
+// windowed cursor over the MOTION block of a memory-mapped BVH file
+// only the most recent frames are decoded, into a fixed ring of slots,
+// so memory use depends on the window size and not on the clip length
+class BVHStream
+	{ // class BVHStream
+	public:
+	// constructor - starts out empty
+	BVHStream();
+
+	// map the file, returns false on failure
+	bool Open(const char* fileName);
+
+	// the mapped text, for parsing the hierarchy
+	const char* Data() const { return file.Data(); }
+	const char* End() const { return file.End(); }
+
+	// start streaming frames from the given position in the text
+	// the channel map gives the layout needed to pull out the rotations
+	void Begin(const char* motionStart, const std::vector<JointChannels>& channelMap, int windowFrames);
+
+	// make sure a frame is in the window, decoding forward (or rewinding) as needed
+	// returns false if the frame is past the end of the file or cannot be decoded
+	bool Fetch(int frame);
+
+	// the raw channel values of a frame that has been fetched
+	const float* FrameChannels(int frame) const { return ring.FrameChannels(frame % windowFrames); }
+
+	// the negated rotation of a joint in a frame that has been fetched
+	Cartesian3 Rotation(int frame, int joint) const { return ring.Rotation(frame % windowFrames, joint); }
+
+	// and the same as a quaternion
+	Quaternion Orientation(int frame, int joint) const { return ring.Orientation(frame % windowFrames, joint); }
+
+	// fetch a frame and point at its four orientation rows (w, x, y, z), returns false on failure
+	bool OrientationRows(int frame, const float* rows[4]);
+
+	// the range of frames currently decoded
+	int WindowStart() const { return windowStart; }
+	int WindowEnd() const { return nextFrame; }
+
+	private:
+	// go back to the first frame
+	void Rewind();
+
+	// decode the next line of text into the slot for nextFrame
+	bool DecodeNext();
+
+	// skip the next line of text without decoding it
+	bool SkipNext();
+
+	// give the text we have already read back to the OS
+	void DiscardBehind();
+
+	// the mapped file
+	MappedFile file;
+
+	// where the frame data starts, and where the next frame will be read from
+	const char* motionStart;
+	const char* cursor;
+	// everything before this has been handed back to the OS
+	const char* discarded;
+
+	// frame number that the cursor will decode next, and the oldest frame still held
+	int nextFrame;
+	int windowStart;
+
+	// the ring of decoded frames, one slot of the tracks per frame in the window
+	int windowFrames;
+	AnimationTracks ring;
+
+	// scratch space for the tokens of the line being decoded
+	std::vector<std::string_view> tokens;
+
+	// the channel layout of each joint
+	std::vector<JointChannels> layout;
+	}; // class BVHStream
+
+#endif
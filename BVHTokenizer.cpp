@@ -0,0 +1,132 @@
+#include "BVHTokenizer.h"
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+// true for the characters that separate tokens
+static inline bool IsSpace(char c)
+	{ // IsSpace()
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+	} // IsSpace()
+
+// constructor takes the range of characters to walk
+BVHTokenizer::BVHTokenizer(const char* begin, const char* end)
+	: current(begin), end(end)
+	{ // constructor
+	} // constructor
+
+// read the next non-empty line and split it into tokens
+// returns false once the text is exhausted
+bool BVHTokenizer::NextLine(std::vector<std::string_view>& tokens)
+	{ // NextLine()
+	tokens.clear();
+	// keep going until we find a line with something on it
+	while (current < end && tokens.empty())
+		{ // more text
+		// find the end of this line
+		const char* lineEnd = static_cast<const char*>(memchr(current, '\n', end - current));
+		if (lineEnd == nullptr)
+			lineEnd = end;
+		// split it
+		SplitLine(current, lineEnd, tokens);
+		// and step over the newline
+		current = (lineEnd < end) ? lineEnd + 1 : end;
+		} // more text
+	return !tokens.empty();
+	} // NextLine()
+
+// count the lines in a block of text that have at least one token on them
+size_t BVHTokenizer::CountLines(const char* begin, const char* end)
+	{ // CountLines()
+	size_t nLines = 0;
+	while (begin < end)
+		{ // per line
+		const char* lineEnd = static_cast<const char*>(memchr(begin, '\n', end - begin));
+		if (lineEnd == nullptr)
+			lineEnd = end;
+		// only lines with something other than whitespace count
+		for (const char* c = begin; c < lineEnd; c++)
+			if (!IsSpace(*c))
+				{ // non-empty line
+				nLines++;
+				break;
+				} // non-empty line
+		begin = lineEnd + 1;
+		} // per line
+	return nLines;
+	} // CountLines()
+
+// split a single line into tokens
+void BVHTokenizer::SplitLine(const char* lineStart, const char* lineEnd, std::vector<std::string_view>& tokens)
+	{ // SplitLine()
+	tokens.clear();
+	const char* c = lineStart;
+	while (c < lineEnd)
+		{ // more characters
+		// skip any whitespace
+		while (c < lineEnd && IsSpace(*c))
+			c++;
+		if (c == lineEnd)
+			break;
+		// the token runs until the next whitespace
+		const char* tokenStart = c;
+		while (c < lineEnd && !IsSpace(*c))
+			c++;
+		tokens.emplace_back(tokenStart, c - tokenStart);
+		} // more characters
+	} // SplitLine()
+
+// convert a token to a float, returns false on malformed input
+bool BVHTokenizer::ParseFloat(std::string_view token, float& value)
+	{ // ParseFloat()
+	const char* first = token.data();
+	const char* last = first + token.size();
+	// std::stof accepted an explicit plus sign, so we do too
+	if (first != last && *first == '+')
+		first++;
+	if (first == last)
+		return false;
+#if defined(__cpp_lib_to_chars)
+	std::from_chars_result result = std::from_chars(first, last, value);
+	return result.ec == std::errc() && result.ptr == last;
+#else
+	// older standard libraries have no floating point from_chars, so fall back
+	// to strtof on a small stack copy (tokens are never this long in practice)
+	char buffer[64];
+	size_t length = last - first;
+	if (length >= sizeof(buffer))
+		return false;
+	memcpy(buffer, first, length);
+	buffer[length] = '\0';
+	char* stop = nullptr;
+	value = strtof(buffer, &stop);
+	return stop == buffer + length;
+#endif
+	} // ParseFloat()
+
+// convert a token to an integer, returns false on malformed input
+bool BVHTokenizer::ParseInt(std::string_view token, int& value)
+	{ // ParseInt()
+	const char* first = token.data();
+	const char* last = first + token.size();
+	if (first != last && *first == '+')
+		first++;
+	std::from_chars_result result = std::from_chars(first, last, value);
+	return result.ec == std::errc() && result.ptr == last && first != last;
+	} // ParseInt()
+
+// convert a line of channel values into exactly count floats
+// integers such as 0 are values like any other
+bool BVHTokenizer::ParseFrame(const std::vector<std::string_view>& tokens, float* values, int count)
+	{ // ParseFrame()
+	int nValues = 0;
+	// loop through the line, one token at a time
+	for (std::string_view token : tokens)
+		{ // per token
+		// too many values for the channel layout
+		if (nValues == count || !ParseFloat(token, values[nValues]))
+			return false;
+		nValues++;
+		} // per token
+	return nValues == count;
+	} // ParseFrame()
@@ -0,0 +1,46 @@
+#ifndef _BVH_TOKENIZER_H
+#define _BVH_TOKENIZER_H
+
+#include <string_view>
+#include <vector>
+
+// walks a block of BVH text line by line, splitting each line into
+// whitespace-separated tokens that point straight into the text
+// nothing is copied, so the text must outlive the tokens
+class BVHTokenizer
+	{ // class BVHTokenizer
+	public:
+	// constructor takes the range of characters to walk
+	BVHTokenizer(const char* begin, const char* end);
+
+	// read the next non-empty line and split it into tokens
+	// returns false once the text is exhausted
+	bool NextLine(std::vector<std::string_view>& tokens);
+
+	// where the next line starts
+	const char* Position() const { return current; }
+
+	// end of the text
+	const char* End() const { return end; }
+
+	// count the lines in a block of text that have at least one token on them
+	static size_t CountLines(const char* begin, const char* end);
+
+	// split a single line into tokens
+	static void SplitLine(const char* lineStart, const char* lineEnd, std::vector<std::string_view>& tokens);
+
+	// number conversion without temporary strings, returns false on malformed input
+	static bool ParseFloat(std::string_view token, float& value);
+	static bool ParseInt(std::string_view token, int& value);
+
+	// convert a line of channel values into exactly count floats
+	// integers such as 0 are values like any other
+	static bool ParseFrame(const std::vector<std::string_view>& tokens, float* values, int count);
+
+	private:
+	// the text still to be read
+	const char* current;
+	const char* end;
+	}; // class BVHTokenizer
+
+#endif
@@ -0,0 +1,220 @@
+#include "BlendTree.h"
+#include "BVHData.h"
+#include <algorithm>
+#include <cmath>
+
+// blend the inputs into the result, returns false (leaving the identity) if nothing contributes
+bool PoseBlender::Evaluate(const std::vector<BlendInput>& inputs, BlendAccuracy accuracy, SampleMode sampling)
+	{ // Evaluate()
+	return Evaluate(inputs.data(), inputs.size(), accuracy, sampling);
+	} // Evaluate()
+
+// the same for inputs held anywhere
+bool PoseBlender::Evaluate(const BlendInput* inputs, size_t count, BlendAccuracy accuracy, SampleMode sampling)
+	{ // Evaluate()
+	rows.clear();
+	weights.clear();
+	jointCount = 0;
+	evaluated = false;
+	for (size_t index = 0; index < count; index++)
+		if (inputs[index].clip != nullptr && inputs[index].clip->skeleton)
+			jointCount = inputs[index].clip->skeleton->JointCount();
+	// room for every input to be sampled between frames, set aside before any row points into it
+	sampled.resize(4 * jointCount * count);
+	for (size_t index = 0; index < count; index++)
+		{ // per input
+		const BlendInput& input = inputs[index];
+		if (input.clip == nullptr || !input.clip->skeleton || !(input.weight > 0.0f))
+			continue;
+		const float* inputRows[4];
+		if (sampling != SAMPLE_STEP && input.fraction > 0.0f)
+			{ // between frames
+			float* sampledRows[4];
+			for (int component = 0; component < 4; component++)
+				inputRows[component] = sampledRows[component] = sampled.data() + (4 * index + component) * jointCount;
+			if (!input.clip->SampleOrientations(input.frame, input.fraction, sampling, accuracy, sampledRows))
+				continue;
+			} // between frames
+		else if (!input.clip->OrientationRows(input.frame, inputRows))
+			continue;
+		rows.insert(rows.end(), inputRows, inputRows + 4);
+		weights.push_back(input.weight);
+		} // per input
+	result.resize(4 * jointCount);
+	float* blended[4];
+	for (int component = 0; component < 4; component++)
+		blended[component] = result.data() + component * jointCount;
+
+	int inputCount = weights.size();
+	if (inputCount == 0)
+		{ // nothing to blend
+		for (int component = 0; component < 4; component++)
+			std::fill(blended[component], blended[component] + jointCount, (component == 0) ? 1.0f : 0.0f);
+		return false;
+		} // nothing to blend
+	evaluated = true;
+	if (inputCount == 1)
+		{ // a single clip
+		for (int component = 0; component < 4; component++)
+			std::copy(rows[component], rows[component] + jointCount, blended[component]);
+		return true;
+		} // a single clip
+	// any number of inputs, the same way, so adding one with next to no weight
+	// moves nothing by more than next to nothing
+	BlendManyQuaternions(rows.data(), weights.data(), inputCount, blended, jointCount, accuracy);
+	return true;
+	} // Evaluate()
+
+// apply a layer to the result, touching only the joints in its mask
+bool PoseBlender::ApplyLayer(const PoseLayer& layer, BlendAccuracy accuracy)
+	{ // ApplyLayer()
+	if (!evaluated || layer.clip == nullptr || layer.mask == nullptr || !(layer.weight > 0.0f) || layer.mask->JointCount() == 0)
+		return false;
+	// the mask is in order, so its last joint is the furthest it reaches into the rows
+	bool additive = layer.mode == LAYER_ADDITIVE;
+	int lastJoint = layer.mask->Joints()[layer.mask->JointCount() - 1];
+	auto reaches = [lastJoint](const BVHData* clip) { return clip->skeleton && lastJoint < clip->skeleton->JointCount(); };
+	if (lastJoint >= jointCount || !reaches(layer.clip) || (additive && layer.reference != nullptr && !reaches(layer.reference)))
+		return false;
+	const float* layerRows[4];
+	const float* referenceRows[4];
+	if (additive && (layer.reference == nullptr || !layer.reference->OrientationRows(layer.referenceFrame, referenceRows)))
+		return false;
+	if (!layer.clip->OrientationRows(layer.frame, layerRows))
+		return false;
+
+	// gather the masked joints: the pose underneath, and where the layer takes it
+	int count = layer.mask->JointCount();
+	const int* joints = layer.mask->Joints();
+	const float* maskWeights = layer.mask->Weights();
+	layerJoints.resize(9 * count);
+	float* base[4];
+	float* target[4];
+	for (int component = 0; component < 4; component++)
+		{ // per component
+		base[component] = layerJoints.data() + component * count;
+		target[component] = layerJoints.data() + (4 + component) * count;
+		} // per component
+	float* jointWeights = layerJoints.data() + 8 * count;
+	for (int index = 0; index < count; index++)
+		{ // per masked joint
+		int joint = joints[index];
+		Quaternion under = Rotation(joint);
+		Quaternion over(layerRows[0][joint], layerRows[1][joint], layerRows[2][joint], layerRows[3][joint]);
+		// an additive layer carries its rotation away from the reference on top of the pose underneath
+		if (additive)
+			{ // additive
+			Quaternion reference(referenceRows[0][joint], referenceRows[1][joint], referenceRows[2][joint], referenceRows[3][joint]);
+			over = under * (reference.Conjugate() * over);
+			} // additive
+		const float underComponents[4] = { under.w, under.x, under.y, under.z };
+		const float overComponents[4] = { over.w, over.x, over.y, over.z };
+		for (int component = 0; component < 4; component++)
+			{ // per component
+			base[component][index] = underComponents[component];
+			target[component][index] = overComponents[component];
+			} // per component
+		jointWeights[index] = std::min(layer.weight * maskWeights[index], 1.0f);
+		} // per masked joint
+
+	// blend them all at once, and scatter them back
+	BlendQuaternions(base, target, jointWeights, base, count, accuracy);
+	for (int component = 0; component < 4; component++)
+		{ // per component
+		float* row = result.data() + component * jointCount;
+		for (int index = 0; index < count; index++)
+			row[joints[index]] = base[component][index];
+		} // per component
+	return true;
+	} // ApplyLayer()
+
+// the blended rotation of a joint
+Quaternion PoseBlender::Rotation(int joint) const
+	{ // Rotation()
+	return Quaternion(result[joint], result[jointCount + joint], result[2 * jointCount + joint], result[3 * jointCount + joint]);
+	} // Rotation()
+
+// place a clip at a position along the parameter
+void BlendSpace1D::AddClip(const ClipHandle& clip, float position)
+	{ // AddClip()
+	if (!clip || clip->frame_count <= 0)
+		return;
+	auto after = std::upper_bound(clips.begin(), clips.end(), position,
+		[](float value, const Sample& sample) { return value < sample.position; });
+	clips.insert(after, Sample{ clip, position });
+	} // AddClip()
+
+// the clips either side of the parameter, and how far it is from the first to the second
+void BlendSpace1D::Span(float parameter, size_t& previous, size_t& next, float& weight) const
+	{ // Span()
+	next = std::upper_bound(clips.begin(), clips.end(), parameter,
+		[](float value, const Sample& sample) { return value < sample.position; }) - clips.begin();
+	previous = (next > 0) ? next - 1 : 0;
+	next = std::min(next, clips.size() - 1);
+	float span = clips[next].position - clips[previous].position;
+	weight = (next != previous && span > 0.0f) ? (parameter - clips[previous].position) / span : 0.0f;
+	} // Span()
+
+// the length of one cycle in seconds at a parameter
+double BlendSpace1D::CycleDuration(float parameter) const
+	{ // CycleDuration()
+	if (clips.empty())
+		return 0.0;
+	size_t previous, next;
+	float weight;
+	Span(parameter, previous, next, weight);
+	auto duration = [&](size_t index) { return (double) clips[index].clip->frame_count * clips[index].clip->frame_time; };
+	return (1.0 - weight) * duration(previous) + weight * duration(next);
+	} // CycleDuration()
+
+// add the weighted inputs at a parameter and a phase, each scaled by the weight given
+void BlendSpace1D::Inputs(float parameter, double phase, float weight, std::vector<BlendInput>& inputs) const
+	{ // Inputs()
+	if (clips.empty())
+		return;
+	size_t previous, next;
+	float nextWeight;
+	Span(parameter, previous, next, nextWeight);
+
+	// each clip at the same phase of its own cycle
+	phase -= std::floor(phase);
+	auto input = [&](size_t index, float inputWeight)
+		{ // input()
+		const BVHData* clip = clips[index].clip.get();
+		double position = phase * clip->frame_count;
+		int frame = std::min((int) position, clip->frame_count - 1);
+		inputs.push_back(BlendInput{ clip, frame, inputWeight, (float) (position - frame) });
+		}; // input()
+	if (nextWeight < 1.0f)
+		input(previous, weight * (1.0f - nextWeight));
+	if (nextWeight > 0.0f)
+		input(next, weight * nextWeight);
+	} // Inputs()
+
+// add a joint (or change its weight, if it is already in)
+void JointMask::Add(int joint, float weight)
+	{ // Add()
+	if (joint < 0)
+		return;
+	auto position = std::lower_bound(joints.begin(), joints.end(), joint);
+	size_t index = position - joints.begin();
+	if (position != joints.end() && *position == joint)
+		{ // already in
+		weights[index] = weight;
+		return;
+		} // already in
+	joints.insert(position, joint);
+	weights.insert(weights.begin() + index, weight);
+	if ((size_t) joint / 64 >= bits.size())
+		bits.resize(joint / 64 + 1, 0);
+	bits[joint / 64] |= uint64_t(1) << (joint % 64);
+	} // Add()
+
+// add a joint and everything below it
+void JointMask::AddSubtree(const Skeleton& rig, int joint, float weight)
+	{ // AddSubtree()
+	if (joint < 0 || joint >= rig.JointCount())
+		return;
+	for (int descendant = joint; descendant < rig.subtreeEnd[joint]; descendant++)
+		Add(descendant, weight);
+	} // AddSubtree()
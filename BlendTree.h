@@ -0,0 +1,175 @@
+#ifndef _BLEND_TREE_H
+#define _BLEND_TREE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Quaternion.h"
+#include "PoseBlend.h"
+
+// clips are shared read-only by handle (as in BVHData.h)
+class BVHData;
+class Skeleton;
+typedef std::shared_ptr<const BVHData> ClipHandle;
+
+// how a clip is sampled between its frames
+enum SampleMode
+	{ // enum SampleMode
+	// hold each frame until the next one
+	SAMPLE_STEP,
+	// interpolate between the two frames either side
+	SAMPLE_LINEAR,
+	// a cubic through the four frames around, from tangents precomputed by
+	// BVHData::BuildCubicTracks (linear for clips without them)
+	SAMPLE_CUBIC
+	}; // enum SampleMode
+
+// one weighted clip going into a blend
+struct BlendInput
+	{ // struct BlendInput
+	// the clip and the frame of it to sample
+	const BVHData* clip;
+	int frame;
+	// how much of it goes into the result (the weights need not add up to one)
+	float weight;
+	// how far on towards the next frame (wrapping round the clip) to sample, 0 to 1
+	float fraction = 0.0f;
+	}; // struct BlendInput
+
+// a sparse set of joints with a weight each, e.g. the upper body, for a layer to touch
+// the joints are kept in order, so parents come before their children
+class JointMask
+	{ // class JointMask
+	public:
+	// add a joint (or change its weight, if it is already in)
+	void Add(int joint, float weight = 1.0f);
+
+	// add a joint and everything below it
+	void AddSubtree(const Skeleton& rig, int joint, float weight = 1.0f);
+
+	// whether a joint is in the mask
+	bool Contains(int joint) const { return joint >= 0 && (size_t) joint / 64 < bits.size() && (bits[joint / 64] >> (joint % 64) & 1); }
+
+	// the joints in the mask, and their weights
+	int JointCount() const { return joints.size(); }
+	const int* Joints() const { return joints.data(); }
+	const float* Weights() const { return weights.data(); }
+
+	private:
+	std::vector<int> joints;
+	std::vector<float> weights;
+	// one bit per joint, for Contains
+	std::vector<uint64_t> bits;
+	}; // class JointMask
+
+// how a layer combines with the pose underneath it
+enum LayerMode
+	{ // enum LayerMode
+	// replace the rotation of each masked joint
+	LAYER_OVERRIDE,
+	// add the layer's rotation relative to its reference pose
+	LAYER_ADDITIVE
+	}; // enum LayerMode
+
+// a clip played over part of the skeleton, on top of a blended pose
+struct PoseLayer
+	{ // struct PoseLayer
+	LayerMode mode;
+	// the clip and frame played on the layer, and how much of it (scaled by the mask)
+	const BVHData* clip;
+	int frame;
+	float weight;
+	// the joints the layer touches, which must stay alive while it is in use
+	const JointMask* mask;
+	// for additive layers, the pose the layer is relative to, usually its first frame
+	const BVHData* reference;
+	int referenceFrame;
+	}; // struct PoseLayer
+
+// blends the orientation of every joint over any number of weighted clips on the same rig
+// all the scratch space is kept from one call to the next, so nothing is allocated per frame
+// inputs that share a streamed clip must all lie within its window
+class PoseBlender
+	{ // class PoseBlender
+	public:
+	// blend the inputs into the result; inputs with no weight (or no frame) are skipped
+	// inputs part way between frames are sampled first, as the sampling mode says
+	// one input is copied, and more are slerped (or nlerped, by accuracy) into one another
+	// in turn, in a single pass over the joints
+	// returns false, leaving the identity, if nothing contributes
+	bool Evaluate(const std::vector<BlendInput>& inputs, BlendAccuracy accuracy = BLEND_EXACT, SampleMode sampling = SAMPLE_LINEAR);
+
+	// the same for inputs held anywhere, e.g. a single one on the stack
+	bool Evaluate(const BlendInput* inputs, size_t count, BlendAccuracy accuracy = BLEND_EXACT, SampleMode sampling = SAMPLE_LINEAR);
+
+	// apply a layer to the result, touching only the joints in its mask, so the work
+	// is proportional to the size of the mask rather than of the skeleton
+	// layers apply in the order this is called; returns false (changing nothing) if
+	// the layer has no weight, mask or frame, if there is no pose from Evaluate to apply
+	// it to, or if its mask reaches past the joints of the pose or of the layer's clips
+	bool ApplyLayer(const PoseLayer& layer, BlendAccuracy accuracy = BLEND_EXACT);
+
+	// number of joints in the result
+	int JointCount() const { return jointCount; }
+
+	// one row of the result: component 0 to 3 is w, x, y, z, one float per joint
+	const float* Orientation(int component) const { return result.data() + component * jointCount; }
+
+	// the blended rotation of a joint
+	Quaternion Rotation(int joint) const;
+
+	private:
+	int jointCount = 0;
+	// whether the result is a pose from the last Evaluate (rather than the identity it
+	// leaves when nothing contributes, or nothing at all before the first one)
+	bool evaluated = false;
+	// four rows (w, x, y, z) of one float per joint
+	std::vector<float> result;
+	// the orientation rows of each contributing input, four to an input, and their weights
+	std::vector<const float*> rows;
+	std::vector<float> weights;
+	// inputs sampled between frames: four rows of one float per joint for each input
+	std::vector<float> sampled;
+	// the masked joints of a layer, gathered: four rows each of the pose underneath
+	// and of the layer, then one row of weights
+	std::vector<float> layerJoints;
+	}; // class PoseBlender
+
+// a one dimensional blend space: clips placed along a parameter (e.g. run, veer-left
+// and veer-right along the steering angle), of which the two either side of the
+// parameter are weighted by how close they are
+// every clip plays at the same phase of its cycle, so clips of different lengths stay in step
+class BlendSpace1D
+	{ // class BlendSpace1D
+	public:
+	// place a clip at a position along the parameter
+	void AddClip(const ClipHandle& clip, float position);
+
+	// number of clips in the space
+	int ClipCount() const { return clips.size(); }
+
+	// the length of one cycle in seconds at a parameter, blended between the clips either side
+	// the phase of a character in the space goes up by dt over this, so it never jumps
+	// when the parameter changes
+	double CycleDuration(float parameter) const;
+
+	// add the weighted inputs at a parameter and a phase (0 to 1, wrapping round) to the
+	// inputs, each scaled by the weight given, e.g. that of a state being faded
+	// each clip is sampled part way between its frames, so the inputs do not step
+	void Inputs(float parameter, double phase, float weight, std::vector<BlendInput>& inputs) const;
+
+	private:
+	// the clips either side of the parameter, and how far it is from the first to the second
+	// (off either end, both are the end clip)
+	void Span(float parameter, size_t& previous, size_t& next, float& weight) const;
+
+	// the clips, kept in order of position
+	struct Sample
+		{ // struct Sample
+		ClipHandle clip;
+		float position;
+		}; // struct Sample
+	std::vector<Sample> clips;
+	}; // class BlendSpace1D
+
+#endif
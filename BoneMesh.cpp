@@ -0,0 +1,93 @@
+#include "BoneMesh.h"
+#include <cmath>
+
+// constructor
+CylinderMesh::CylinderMesh(int slices)
+	: slices(slices)
+	{ // constructor
+	// the centres of the top and bottom
+	points.push_back(Homogeneous4(0.0f, 0.0f, 1.0f, 1.0f));
+	points.push_back(Homogeneous4(0.0f, 0.0f, 0.0f, 1.0f));
+	normals.push_back(Homogeneous4(0.0f, 0.0f, 1.0f, 0.0f));
+	normals.push_back(Homogeneous4(0.0f, 0.0f, -1.0f, 0.0f));
+
+	// the rings, and a normal through the middle of each slice's side
+	for (int i = 0; i < slices; i++)
+		{ // per slice
+		float theta = (float) (i * 2.0f * M_PI / slices);
+		float nextTheta = (float) ((i + 1) * 2.0f * M_PI / slices);
+		float midTheta = 0.5f * (theta + nextTheta);
+		points.push_back(Homogeneous4(std::cos(theta), std::sin(theta), 1.0f, 1.0f));
+		points.push_back(Homogeneous4(std::cos(theta), std::sin(theta), 0.0f, 1.0f));
+		normals.push_back(Homogeneous4(std::cos(midTheta), std::sin(midTheta), 0.0f, 0.0f));
+		} // per slice
+
+	// the top, the two side triangles and the bottom of each slice
+	for (int i = 0; i < slices; i++)
+		{ // per slice
+		int top = 2 + 2 * i, nextTop = 2 + 2 * ((i + 1) % slices);
+		int bottom = top + 1, nextBottom = nextTop + 1;
+		int slicePoints[12] = { 0, top, nextTop, nextTop, top, bottom, nextTop, bottom, nextBottom, nextBottom, bottom, 1 };
+		int sliceNormals[4] = { 0, 2 + i, 2 + i, 1 };
+		for (int vertex = 0; vertex < 12; vertex++)
+			{ // per vertex
+			pointIndex.push_back(slicePoints[vertex]);
+			normalIndex.push_back(sliceNormals[vertex / 3]);
+			} // per vertex
+		} // per slice
+	} // constructor
+
+// start a new frame of bones
+void BoneBatch::Begin(int slices)
+	{ // Begin()
+	// the mesh is only worked out again if the number of slices changes
+	if (slices != mesh.Slices())
+		mesh = CylinderMesh(slices);
+	bones = 0;
+	vertices.clear();
+	normals.clear();
+	} // Begin()
+
+// add a cylinder of the given radius and length along z, after a transform
+void BoneBatch::AddCylinder(const Matrix4& transform, float radius, float length)
+	{ // AddCylinder()
+	// stretch the unit cylinder as part of the transform of its points
+	Matrix4 pointMatrix = transform;
+	for (int row = 0; row < 4; row++)
+		{ // per row
+		pointMatrix[row][0] *= radius;
+		pointMatrix[row][1] *= radius;
+		pointMatrix[row][2] *= length;
+		} // per row
+	bonePoints.resize(mesh.points.size());
+	pointMatrix.Transform(mesh.points.data(), bonePoints.data(), mesh.points.size());
+	// the normals have w = 0, so the translation drops out
+	boneNormals.resize(mesh.normals.size());
+	transform.Transform(mesh.normals.data(), boneNormals.data(), mesh.normals.size());
+
+	// and lay the triangles out after the bones before
+	size_t start = vertices.size();
+	vertices.resize(start + mesh.pointIndex.size());
+	normals.resize(start + mesh.normalIndex.size());
+	for (size_t vertex = 0; vertex < mesh.pointIndex.size(); vertex++)
+		{ // per vertex
+		vertices[start + vertex] = bonePoints[mesh.pointIndex[vertex]];
+		normals[start + vertex] = boneNormals[mesh.normalIndex[vertex]];
+		} // per vertex
+	bones++;
+	} // AddCylinder()
+
+// draw everything added since Begin as one array of triangles
+void BoneBatch::Draw() const
+	{ // Draw()
+	if (vertices.empty())
+		return;
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	// the normals are homogeneous too, so step over their w
+	glVertexPointer(4, GL_FLOAT, sizeof(Homogeneous4), &vertices[0].x);
+	glNormalPointer(GL_FLOAT, sizeof(Homogeneous4), &normals[0].x);
+	glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	} // Draw()
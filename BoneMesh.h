@@ -0,0 +1,78 @@
+#ifndef _BONE_MESH_H
+#define _BONE_MESH_H
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include "Homogeneous4.h"
+#include "Matrix4.h"
+
+// the number of slices round each bone
+const int BONE_SLICES = 10;
+
+// a closed cylinder of radius 1 from z = 0 to z = 1, worked out once for a number of slices:
+// its distinct points and face normals, and which of them each vertex of its triangles uses
+class CylinderMesh
+	{ // class CylinderMesh
+	public:
+	// constructor
+	explicit CylinderMesh(int slices = BONE_SLICES);
+
+	int Slices() const { return slices; }
+
+	// the distinct points (the two centres, then the top and bottom rings) and normals
+	// (up, down, then the side of each slice), with w = 1 and w = 0 respectively
+	std::vector<Homogeneous4> points;
+	std::vector<Homogeneous4> normals;
+
+	// for each vertex of the triangles (four per slice), the point and the normal it uses
+	std::vector<int> pointIndex;
+	std::vector<int> normalIndex;
+
+	private:
+	int slices;
+	}; // class CylinderMesh
+
+// the bones of a frame, gathered into one vertex array so they are drawn in a single call
+// each bone's points go through a batched (SIMD) transform, and nothing is allocated once
+// the arrays have grown to the size of the skeleton
+class BoneBatch
+	{ // class BoneBatch
+	public:
+	// start a new frame of bones, each with the given number of slices
+	void Begin(int slices = BONE_SLICES);
+
+	// add a cylinder of the given radius and length along z, after a transform (into view space)
+	void AddCylinder(const Matrix4& transform, float radius, float length);
+
+	// draw everything added since Begin as one array of triangles
+	void Draw() const;
+
+	// how many bones were added since Begin, and how many vertices they came to
+	int Bones() const { return bones; }
+	size_t VertexCount() const { return vertices.size(); }
+
+	// the vertices and (flat) normals that Draw sends
+	const Homogeneous4* Vertices() const { return vertices.data(); }
+	const Homogeneous4* Normals() const { return normals.data(); }
+
+	private:
+	CylinderMesh mesh;
+	int bones = 0;
+	// one bone's distinct points and normals after its transform
+	std::vector<Homogeneous4> bonePoints;
+	std::vector<Homogeneous4> boneNormals;
+	// every vertex of the frame, and its normal
+	std::vector<Homogeneous4> vertices;
+	std::vector<Homogeneous4> normals;
+	}; // class BoneBatch
+
+#endif
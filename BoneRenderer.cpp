@@ -0,0 +1,121 @@
+#include "BoneRenderer.h"
+
+// the attributes, in the order of their indices: the cylinder's, then the instance's
+static const char* const BONE_ATTRIBUTES[] =
+	{ "position", "normal", "boneColumn0", "boneColumn1", "boneColumn2", "boneColumn3", "boneScale" };
+static const int BONE_ATTRIBUTE_COUNT = sizeof(BONE_ATTRIBUTES) / sizeof(BONE_ATTRIBUTES[0]);
+// the first of the instance's attributes
+static const int FIRST_INSTANCE_ATTRIBUTE = 2;
+
+// GLSL 1.20, so that it runs on legacy contexts, using their matrices and lighting
+static const char* BONE_VERTEX_SHADER =
+	"#version 120\n"
+	GLSL_FIXED_FUNCTION_LIGHTING
+	"attribute vec4 position;\n"
+	"attribute vec3 normal;\n"
+	"attribute vec4 boneColumn0;\n"
+	"attribute vec4 boneColumn1;\n"
+	"attribute vec4 boneColumn2;\n"
+	"attribute vec4 boneColumn3;\n"
+	"attribute vec4 boneScale;\n"
+	"varying vec4 colour;\n"
+	"void main()\n"
+	"	{\n"
+	"	mat4 bone = mat4(boneColumn0, boneColumn1, boneColumn2, boneColumn3);\n"
+	"	vec4 eyePosition = gl_ModelViewMatrix * (bone * (position * boneScale));\n"
+	"	vec3 eyeNormal = normalize(gl_NormalMatrix * (mat3(bone[0].xyz, bone[1].xyz, bone[2].xyz) * normal));\n"
+	"	colour = FixedFunctionLighting(eyePosition, eyeNormal);\n"
+	"	gl_Position = gl_ProjectionMatrix * eyePosition;\n"
+	"	}\n";
+
+// look up the entry points, build the shaders and upload the cylinder
+bool BoneRenderer::Initialise(GLProcLoader loader, int slices)
+	{ // Initialise()
+	Release();
+	if (!gl.Load(loader))
+		return false;
+	program = BuildProgram(gl, BONE_VERTEX_SHADER, LIT_FRAGMENT_SHADER, BONE_ATTRIBUTES, BONE_ATTRIBUTE_COUNT);
+	if (program == 0)
+		return false;
+
+	// lay the cylinder out as triangles, each vertex followed by its normal
+	CylinderMesh mesh(slices);
+	std::vector<Homogeneous4> vertices;
+	vertices.reserve(2 * mesh.pointIndex.size());
+	for (size_t vertex = 0; vertex < mesh.pointIndex.size(); vertex++)
+		{ // per vertex
+		vertices.push_back(mesh.points[mesh.pointIndex[vertex]]);
+		vertices.push_back(mesh.normals[mesh.normalIndex[vertex]]);
+		} // per vertex
+	meshVertices = mesh.pointIndex.size();
+
+	gl.GenBuffers(1, &meshBuffer);
+	gl.BindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+	gl.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Homogeneous4), vertices.data(), GL_STATIC_DRAW);
+	gl.GenBuffers(1, &instanceBuffer);
+	gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+	} // Initialise()
+
+// delete the buffers and the program
+void BoneRenderer::Release()
+	{ // Release()
+	if (meshBuffer != 0)
+		gl.DeleteBuffers(1, &meshBuffer);
+	if (instanceBuffer != 0)
+		gl.DeleteBuffers(1, &instanceBuffer);
+	if (program != 0)
+		gl.DeleteProgram(program);
+	meshBuffer = instanceBuffer = program = 0;
+	meshVertices = 0;
+	} // Release()
+
+// add a cylinder of the given radius and length along z, after a transform
+void BoneRenderer::AddCylinder(const Matrix4& transform, float radius, float length)
+	{ // AddCylinder()
+	// GLSL matrices are built from their columns
+	columnMajorMatrix columns = transform.columnMajor();
+	instances.insert(instances.end(), columns.coordinates, columns.coordinates + 16);
+	instances.push_back(radius);
+	instances.push_back(radius);
+	instances.push_back(length);
+	instances.push_back(1.0f);
+	} // AddCylinder()
+
+// draw every bone added since Begin with a single instanced call
+void BoneRenderer::Draw()
+	{ // Draw()
+	if (!Ready() || instances.empty())
+		return;
+	gl.UseProgram(program);
+
+	// the cylinder, from the buffer it has been in since Initialise
+	gl.BindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+	gl.EnableVertexAttribArray(0);
+	gl.VertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(Homogeneous4), (const void*) 0);
+	gl.EnableVertexAttribArray(1);
+	gl.VertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(Homogeneous4), (const void*) sizeof(Homogeneous4));
+
+	// this frame's instances, into a fresh buffer so the last frame's draw is never waited on
+	gl.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	gl.BufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(float), instances.data(), GL_STREAM_DRAW);
+	for (int attribute = FIRST_INSTANCE_ATTRIBUTE; attribute < BONE_ATTRIBUTE_COUNT; attribute++)
+		{ // per instance attribute
+		size_t offset = (attribute - FIRST_INSTANCE_ATTRIBUTE) * 4 * sizeof(float);
+		gl.EnableVertexAttribArray(attribute);
+		gl.VertexAttribPointer(attribute, 4, GL_FLOAT, GL_FALSE, INSTANCE_FLOATS * sizeof(float), (const void*) offset);
+		gl.VertexAttribDivisor(attribute, 1);
+		} // per instance attribute
+
+	gl.DrawArraysInstanced(GL_TRIANGLES, 0, meshVertices, Bones());
+
+	// and leave things as the immediate-mode drawing expects them
+	for (int attribute = 0; attribute < BONE_ATTRIBUTE_COUNT; attribute++)
+		{ // per attribute
+		if (attribute >= FIRST_INSTANCE_ATTRIBUTE)
+			gl.VertexAttribDivisor(attribute, 0);
+		gl.DisableVertexAttribArray(attribute);
+		} // per attribute
+	gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+	gl.UseProgram(0);
+	} // Draw()
@@ -0,0 +1,52 @@
+#ifndef _BONE_RENDERER_H
+#define _BONE_RENDERER_H
+
+#include <vector>
+#include "GLFunctions.h"
+#include "BoneMesh.h"
+#include "Matrix4.h"
+
+// retained-mode bones: the unit cylinder is uploaded to a vertex buffer once, and every
+// bone of every character is drawn by one instanced call per frame, with only its transform
+// and size going into an instance buffer, so the vertices never pass through the CPU
+// the shader lights them as the fixed-function pipeline would, in the current material
+// needs instanced arrays (GL 3.3, or ARB_instanced_arrays on a legacy context)
+class BoneRenderer
+	{ // class BoneRenderer
+	public:
+	// look up the entry points, build the shaders and upload the cylinder, with the context current
+	// returns false, leaving the renderer unready, if the context cannot draw instanced
+	bool Initialise(GLProcLoader loader, int slices = BONE_SLICES);
+
+	// delete the buffers and the program, with the context current
+	void Release();
+
+	// whether bones added will be drawn
+	bool Ready() const { return program != 0; }
+
+	// start a new frame of bones
+	void Begin() { instances.clear(); }
+
+	// add a cylinder of the given radius and length along z, after a transform (into view space)
+	void AddCylinder(const Matrix4& transform, float radius, float length);
+
+	// draw every bone added since Begin with a single instanced call
+	void Draw();
+
+	// how many bones were added since Begin
+	int Bones() const { return instances.size() / INSTANCE_FLOATS; }
+
+	private:
+	// each instance is the four columns of its transform, then its scale along each axis
+	static const int INSTANCE_FLOATS = 20;
+
+	GLFunctions gl;
+	GLuint program = 0;
+	// the cylinder's vertices (a point, then a normal with w = 0) and the instances
+	GLuint meshBuffer = 0;
+	GLuint instanceBuffer = 0;
+	GLsizei meshVertices = 0;
+	std::vector<float> instances;
+	}; // class BoneRenderer
+
+#endif
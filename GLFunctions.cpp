@@ -0,0 +1,106 @@
+#include "GLFunctions.h"
+#include <iostream>
+#include <vector>
+
+// the fragment shader to go with vertex shaders that light their vertices
+const char* const LIT_FRAGMENT_SHADER =
+	"#version 120\n"
+	"varying vec4 colour;\n"
+	"void main()\n"
+	"	{\n"
+	"	gl_FragColor = colour;\n"
+	"	}\n";
+
+// look up one entry point into a function pointer of whatever type it is
+template <typename Function> static bool LoadFunction(GLProcLoader loader, Function& function, const char* name, const char* fallback = nullptr)
+	{ // LoadFunction()
+	void* address = loader(name);
+	if (address == nullptr && fallback != nullptr)
+		address = loader(fallback);
+	function = reinterpret_cast<Function>(address);
+	return address != nullptr;
+	} // LoadFunction()
+
+// look up every entry point
+bool GLFunctions::Load(GLProcLoader loader)
+	{ // Load()
+	bool found = true;
+	found &= LoadFunction(loader, GenBuffers, "glGenBuffers");
+	found &= LoadFunction(loader, DeleteBuffers, "glDeleteBuffers");
+	found &= LoadFunction(loader, BindBuffer, "glBindBuffer");
+	found &= LoadFunction(loader, BufferData, "glBufferData");
+	found &= LoadFunction(loader, CreateShader, "glCreateShader");
+	found &= LoadFunction(loader, DeleteShader, "glDeleteShader");
+	found &= LoadFunction(loader, ShaderSource, "glShaderSource");
+	found &= LoadFunction(loader, CompileShader, "glCompileShader");
+	found &= LoadFunction(loader, GetShaderiv, "glGetShaderiv");
+	found &= LoadFunction(loader, GetShaderInfoLog, "glGetShaderInfoLog");
+	found &= LoadFunction(loader, CreateProgram, "glCreateProgram");
+	found &= LoadFunction(loader, DeleteProgram, "glDeleteProgram");
+	found &= LoadFunction(loader, AttachShader, "glAttachShader");
+	found &= LoadFunction(loader, BindAttribLocation, "glBindAttribLocation");
+	found &= LoadFunction(loader, LinkProgram, "glLinkProgram");
+	found &= LoadFunction(loader, GetProgramiv, "glGetProgramiv");
+	found &= LoadFunction(loader, GetProgramInfoLog, "glGetProgramInfoLog");
+	found &= LoadFunction(loader, UseProgram, "glUseProgram");
+	found &= LoadFunction(loader, GetUniformLocation, "glGetUniformLocation");
+	found &= LoadFunction(loader, UniformMatrix4fv, "glUniformMatrix4fv");
+	found &= LoadFunction(loader, EnableVertexAttribArray, "glEnableVertexAttribArray");
+	found &= LoadFunction(loader, DisableVertexAttribArray, "glDisableVertexAttribArray");
+	found &= LoadFunction(loader, VertexAttribPointer, "glVertexAttribPointer");
+	// instancing is core from GL 3.3, and an extension on older (e.g. legacy macOS) contexts
+	found &= LoadFunction(loader, VertexAttribDivisor, "glVertexAttribDivisor", "glVertexAttribDivisorARB");
+	found &= LoadFunction(loader, DrawArraysInstanced, "glDrawArraysInstanced", "glDrawArraysInstancedARB");
+	return found;
+	} // Load()
+
+// compile one shader, returning 0 if it fails
+static GLuint CompileShader(const GLFunctions& gl, GLenum type, const char* source)
+	{ // CompileShader()
+	GLuint shader = gl.CreateShader(type);
+	gl.ShaderSource(shader, 1, &source, nullptr);
+	gl.CompileShader(shader);
+	GLint compiled = GL_FALSE;
+	gl.GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled == GL_TRUE)
+		return shader;
+	std::vector<char> log(4096);
+	gl.GetShaderInfoLog(shader, log.size(), nullptr, log.data());
+	std::cout << "Unable to compile shader: " << log.data() << std::endl;
+	gl.DeleteShader(shader);
+	return 0;
+	} // CompileShader()
+
+// compile and link a program, binding each named attribute to its index in the list
+GLuint BuildProgram(const GLFunctions& gl, const char* vertexSource, const char* fragmentSource,
+	const char* const* attributes, int attributeCount)
+	{ // BuildProgram()
+	GLuint vertexShader = CompileShader(gl, GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = CompileShader(gl, GL_FRAGMENT_SHADER, fragmentSource);
+	GLuint program = 0;
+	if (vertexShader != 0 && fragmentShader != 0)
+		{ // compiled
+		program = gl.CreateProgram();
+		gl.AttachShader(program, vertexShader);
+		gl.AttachShader(program, fragmentShader);
+		for (int attribute = 0; attribute < attributeCount; attribute++)
+			gl.BindAttribLocation(program, attribute, attributes[attribute]);
+		gl.LinkProgram(program);
+		GLint linked = GL_FALSE;
+		gl.GetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked != GL_TRUE)
+			{ // failed
+			std::vector<char> log(4096);
+			gl.GetProgramInfoLog(program, log.size(), nullptr, log.data());
+			std::cout << "Unable to link shaders: " << log.data() << std::endl;
+			gl.DeleteProgram(program);
+			program = 0;
+			} // failed
+		} // compiled
+	// the program keeps what it needs of them
+	if (vertexShader != 0)
+		gl.DeleteShader(vertexShader);
+	if (fragmentShader != 0)
+		gl.DeleteShader(fragmentShader);
+	return program;
+	} // BuildProgram()
@@ -0,0 +1,108 @@
+#ifndef _GL_FUNCTIONS_H
+#define _GL_FUNCTIONS_H
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <cstddef>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// the enums of buffers and shaders, which some platforms' gl.h stops short of
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER 0x8B31
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+
+// GLSL 1.20 lighting a vertex in eye space from light 0 and the front material, ambient
+// and diffuse only, as the fixed-function pipeline does for the scene's one light, so
+// shaders pick up the glLight and glMaterial calls made for the immediate-mode drawing
+#define GLSL_FIXED_FUNCTION_LIGHTING \
+	"vec4 FixedFunctionLighting(vec4 eyePosition, vec3 eyeNormal)\n" \
+	"	{\n" \
+	"	vec3 light = normalize(gl_LightSource[0].position.xyz - eyePosition.xyz * gl_LightSource[0].position.w);\n" \
+	"	vec4 colour = gl_FrontLightModelProduct.sceneColor + gl_FrontLightProduct[0].ambient\n" \
+	"		+ max(dot(eyeNormal, light), 0.0) * gl_FrontLightProduct[0].diffuse;\n" \
+	"	return vec4(clamp(colour.rgb, 0.0, 1.0), gl_FrontMaterial.diffuse.a);\n" \
+	"	}\n"
+
+// the fragment shader to go with vertex shaders that light their vertices into a colour varying
+extern const char* const LIT_FRAGMENT_SHADER;
+
+// looks up a GL entry point by name in the current context, e.g. through
+// QOpenGLContext::getProcAddress, or eglGetProcAddress when there is no window
+typedef void* (*GLProcLoader)(const char* name);
+
+// the entry points beyond GL 1.1 that the retained-mode renderers use: buffers,
+// shaders and instancing, which have to be looked up at run time on most platforms
+// the context they were loaded from must be current whenever they are called
+struct GLFunctions
+	{ // struct GLFunctions
+	// look up every entry point, falling back on the ARB names for instancing
+	// returns false if any of them is missing
+	bool Load(GLProcLoader loader);
+
+	// buffers
+	void (APIENTRY* GenBuffers)(GLsizei count, GLuint* buffers) = nullptr;
+	void (APIENTRY* DeleteBuffers)(GLsizei count, const GLuint* buffers) = nullptr;
+	void (APIENTRY* BindBuffer)(GLenum target, GLuint buffer) = nullptr;
+	void (APIENTRY* BufferData)(GLenum target, std::ptrdiff_t size, const void* data, GLenum usage) = nullptr;
+
+	// shaders and programs
+	GLuint (APIENTRY* CreateShader)(GLenum type) = nullptr;
+	void (APIENTRY* DeleteShader)(GLuint shader) = nullptr;
+	void (APIENTRY* ShaderSource)(GLuint shader, GLsizei count, const char* const* source, const GLint* length) = nullptr;
+	void (APIENTRY* CompileShader)(GLuint shader) = nullptr;
+	void (APIENTRY* GetShaderiv)(GLuint shader, GLenum name, GLint* value) = nullptr;
+	void (APIENTRY* GetShaderInfoLog)(GLuint shader, GLsizei size, GLsizei* length, char* log) = nullptr;
+	GLuint (APIENTRY* CreateProgram)() = nullptr;
+	void (APIENTRY* DeleteProgram)(GLuint program) = nullptr;
+	void (APIENTRY* AttachShader)(GLuint program, GLuint shader) = nullptr;
+	void (APIENTRY* BindAttribLocation)(GLuint program, GLuint index, const char* name) = nullptr;
+	void (APIENTRY* LinkProgram)(GLuint program) = nullptr;
+	void (APIENTRY* GetProgramiv)(GLuint program, GLenum name, GLint* value) = nullptr;
+	void (APIENTRY* GetProgramInfoLog)(GLuint program, GLsizei size, GLsizei* length, char* log) = nullptr;
+	void (APIENTRY* UseProgram)(GLuint program) = nullptr;
+	GLint (APIENTRY* GetUniformLocation)(GLuint program, const char* name) = nullptr;
+	void (APIENTRY* UniformMatrix4fv)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) = nullptr;
+
+	// vertex attributes, and instancing
+	void (APIENTRY* EnableVertexAttribArray)(GLuint index) = nullptr;
+	void (APIENTRY* DisableVertexAttribArray)(GLuint index) = nullptr;
+	void (APIENTRY* VertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) = nullptr;
+	void (APIENTRY* VertexAttribDivisor)(GLuint index, GLuint divisor) = nullptr;
+	void (APIENTRY* DrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei instances) = nullptr;
+	}; // struct GLFunctions
+
+// compile and link a program, binding each named attribute to its index in the list
+// returns 0, having printed the log, if either shader or the link fails
+GLuint BuildProgram(const GLFunctions& gl, const char* vertexSource, const char* fragmentSource,
+	const char* const* attributes, int attributeCount);
+
+#endif
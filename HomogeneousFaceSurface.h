@@ -18,6 +18,10 @@ class HomogeneousFaceSurface
 	// vector to hold corresponding normal vectors
 	std::vector<Homogeneous4> normals;
 
+	// scratch space for Render: the vertices and normals in view space
+	std::vector<Homogeneous4> viewVertices;
+	std::vector<Homogeneous4> viewNormals;
+
 	// constructor will initialise to safe values
 	HomogeneousFaceSurface();
 	
@@ -0,0 +1,58 @@
+#include "JointChannels.h"
+
+// code for a channel name: 0-2 position xyz, 3-5 rotation xyz, -1 if unknown
+int ChannelCode(std::string_view name)
+	{ // ChannelCode()
+	for (int code = 0; code < 6; code++)
+		if (name == CHANNEL_NAMES[code])
+			return code;
+	return -1;
+	} // ChannelCode()
+
+// compile the named channels of a joint whose first channel is at the given index
+JointChannels CompileJointChannels(const std::vector<std::string>& names, int firstChannel)
+	{ // CompileJointChannels()
+	JointChannels layout;
+	layout.firstChannel = firstChannel;
+	layout.channelCount = names.size();
+	layout.positionMask = 0;
+	for (int axis = 0; axis < 3; axis++)
+		layout.position[axis] = layout.rotation[axis] = -1;
+
+	// the axes in the order their rotations are listed
+	int order[3];
+	int nRotations = 0;
+	for (size_t i = 0; i < names.size(); i++)
+		{ // per channel
+		int code = ChannelCode(names[i]);
+		if (code < 0)
+			continue;
+		int axis = code % 3;
+		if (code < 3)
+			{ // position channel
+			layout.position[axis] = firstChannel + i;
+			layout.positionMask |= 1 << axis;
+			} // position channel
+		else
+			{ // rotation channel
+			// a repeated axis keeps its place in the order, but the last value wins
+			if (layout.rotation[axis] < 0)
+				order[nRotations++] = axis;
+			layout.rotation[axis] = firstChannel + i;
+			} // rotation channel
+		} // per channel
+	// axes without a channel go last, in x, y, z order
+	for (int axis = 0; axis < 3; axis++)
+		if (layout.rotation[axis] < 0)
+			order[nRotations++] = axis;
+
+	// the first two axes settle the order
+	static const RotationOrder ORDERS[3][3] =
+		{ // ORDERS
+		{ ROTATION_XYZ, ROTATION_XYZ, ROTATION_XZY },
+		{ ROTATION_YXZ, ROTATION_YXZ, ROTATION_YZX },
+		{ ROTATION_ZXY, ROTATION_ZYX, ROTATION_ZXY }
+		}; // ORDERS
+	layout.rotationOrder = ORDERS[order[0]][order[1]];
+	return layout;
+	} // CompileJointChannels()
@@ -0,0 +1,52 @@
+#ifndef _JOINT_CHANNELS_H
+#define _JOINT_CHANNELS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// order in which a joint's rotation channels are listed in the file
+enum RotationOrder
+	{ // enum RotationOrder
+	ROTATION_XYZ,
+	ROTATION_XZY,
+	ROTATION_YXZ,
+	ROTATION_YZX,
+	ROTATION_ZXY,
+	ROTATION_ZYX
+	}; // enum RotationOrder
+
+// the axes (0 x, 1 y, 2 z) of each rotation order, in the order they are listed
+const int ROTATION_AXES[6][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } };
+
+// channel names in code order (0-2 position xyz, 3-5 rotation xyz)
+const char* const CHANNEL_NAMES[6] = { "Xposition", "Yposition", "Zposition", "Xrotation", "Yrotation", "Zrotation" };
+
+// bits of JointChannels::positionMask
+const unsigned char POSITION_X = 1;
+const unsigned char POSITION_Y = 2;
+const unsigned char POSITION_Z = 4;
+
+// the channel layout of one joint, compiled once at load time
+// so that sampling is pure integer indexing into a frame
+struct JointChannels
+	{ // struct JointChannels
+	// where the joint's channels start within a frame, and how many there are
+	int firstChannel;
+	int channelCount;
+	// index within a frame of the x, y and z position and rotation (-1 if absent)
+	int position[3];
+	int rotation[3];
+	// which of the position channels are present
+	unsigned char positionMask;
+	// the order the rotation channels appear in
+	RotationOrder rotationOrder;
+	}; // struct JointChannels
+
+// code for a channel name: 0-2 position xyz, 3-5 rotation xyz, -1 if unknown
+int ChannelCode(std::string_view name);
+
+// compile the named channels of a joint whose first channel is at the given index
+JointChannels CompileJointChannels(const std::vector<std::string>& names, int firstChannel);
+
+#endif
@@ -0,0 +1,44 @@
+#include "JointRoles.h"
+#include <cctype>
+
+// the names used by Mixamo-style rigs
+const RoleName DEFAULT_ROLE_NAMES[] =
+	{ // DEFAULT_ROLE_NAMES
+	{ "Hips", ROLE_HIPS },
+	{ "Pelvis", ROLE_HIPS },
+	{ "Spine", ROLE_SPINE },
+	{ "Neck", ROLE_NECK },
+	{ "Head", ROLE_HEAD },
+	{ "LeftArm", ROLE_LEFT_ARM },
+	{ "LeftHand", ROLE_LEFT_HAND },
+	{ "RightArm", ROLE_RIGHT_ARM },
+	{ "RightHand", ROLE_RIGHT_HAND },
+	{ "LeftUpLeg", ROLE_LEFT_UP_LEG },
+	{ "LeftFoot", ROLE_LEFT_FOOT },
+	{ "RightUpLeg", ROLE_RIGHT_UP_LEG },
+	{ "RightFoot", ROLE_RIGHT_FOOT }
+	}; // DEFAULT_ROLE_NAMES
+const int DEFAULT_ROLE_NAME_COUNT = sizeof(DEFAULT_ROLE_NAMES) / sizeof(DEFAULT_ROLE_NAMES[0]);
+const RoleMap DEFAULT_ROLE_MAP = { DEFAULT_ROLE_NAMES, DEFAULT_ROLE_NAME_COUNT };
+
+// the role of a joint name in a retarget map, or ROLE_NONE
+JointRole RoleFromName(std::string_view name, const RoleName* names, int count)
+	{ // RoleFromName()
+	// drop the namespace
+	size_t colon = name.rfind(':');
+	if (colon != std::string_view::npos)
+		name.remove_prefix(colon + 1);
+
+	for (int entry = 0; entry < count; entry++)
+		{ // per entry
+		std::string_view candidate = names[entry].name;
+		if (candidate.size() != name.size())
+			continue;
+		size_t i = 0;
+		while (i < name.size() && std::tolower((unsigned char) name[i]) == std::tolower((unsigned char) candidate[i]))
+			i++;
+		if (i == name.size())
+			return names[entry].role;
+		} // per entry
+	return ROLE_NONE;
+	} // RoleFromName()
@@ -0,0 +1,53 @@
+#ifndef _JOINT_ROLES_H
+#define _JOINT_ROLES_H
+
+#include <string_view>
+
+// what a joint does in the body, so that runtime code can find the hips or a foot
+// by integer instead of comparing names
+enum JointRole
+	{ // enum JointRole
+	ROLE_NONE,
+	// the first joint of the hierarchy, whatever it is called
+	ROLE_ROOT,
+	ROLE_HIPS,
+	ROLE_SPINE,
+	ROLE_NECK,
+	ROLE_HEAD,
+	ROLE_LEFT_ARM,
+	ROLE_LEFT_HAND,
+	ROLE_RIGHT_ARM,
+	ROLE_RIGHT_HAND,
+	ROLE_LEFT_UP_LEG,
+	ROLE_LEFT_FOOT,
+	ROLE_RIGHT_UP_LEG,
+	ROLE_RIGHT_FOOT,
+	JOINT_ROLE_COUNT
+	}; // enum JointRole
+
+// one entry of a retarget map: joints with this name take this role
+struct RoleName
+	{ // struct RoleName
+	const char* name;
+	JointRole role;
+	}; // struct RoleName
+
+// the names used by Mixamo-style rigs, which Skeleton::Finish resolves against
+extern const RoleName DEFAULT_ROLE_NAMES[];
+extern const int DEFAULT_ROLE_NAME_COUNT;
+
+// a whole retarget map: the names each role goes by in some family of rigs
+struct RoleMap
+	{ // struct RoleMap
+	const RoleName* names;
+	int count;
+	}; // struct RoleMap
+
+// the default names as a map
+extern const RoleMap DEFAULT_ROLE_MAP;
+
+// the role of a joint name in a retarget map, or ROLE_NONE
+// any namespace prefix ("mixamorig1:") is ignored, and so is case
+JointRole RoleFromName(std::string_view name, const RoleName* names = DEFAULT_ROLE_NAMES, int count = DEFAULT_ROLE_NAME_COUNT);
+
+#endif
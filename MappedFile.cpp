@@ -0,0 +1,135 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// constructor - starts out unmapped
+MappedFile::MappedFile()
+	: data(nullptr), size(0)
+#ifdef _WIN32
+	, fileHandle(nullptr), mappingHandle(nullptr)
+#endif
+	{ // constructor
+	} // constructor
+
+// destructor releases the mapping
+MappedFile::~MappedFile()
+	{ // destructor
+	Close();
+	} // destructor
+
+// map the named file, returns false on failure
+bool MappedFile::Open(const char* fileName)
+	{ // Open()
+	// drop anything we were holding before
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{ // empty or unreadable
+		CloseHandle(file);
+		return false;
+		} // empty or unreadable
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+		{ // no mapping
+		CloseHandle(file);
+		return false;
+		} // no mapping
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL)
+		{ // no view
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+		} // no view
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast<const char*>(view);
+	size = (size_t) fileSize.QuadPart;
+#else
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	// mmap refuses zero-length mappings, so treat an empty file as a failure
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{ // empty or unreadable
+		close(fd);
+		return false;
+		} // empty or unreadable
+
+	void* view = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// the mapping keeps its own reference to the file
+	close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	data = static_cast<const char*>(view);
+	size = (size_t) info.st_size;
+#endif
+	return true;
+	} // Open()
+
+// release the mapping (safe to call when nothing is mapped)
+void MappedFile::Close()
+	{ // Close()
+	if (data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE) mappingHandle);
+	CloseHandle((HANDLE) fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<char*>(data), size);
+#endif
+	data = nullptr;
+	size = 0;
+	} // Close()
+
+// hint that the file will be read front to back
+void MappedFile::AdviseSequential()
+	{ // AdviseSequential()
+#ifndef _WIN32
+	if (data != nullptr)
+		madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+#endif
+	} // AdviseSequential()
+
+// hand the pages wholly inside [begin, end) back to the OS
+// they are read back in from the file if they are touched again
+void MappedFile::Discard(const char* begin, const char* end)
+	{ // Discard()
+#ifndef _WIN32
+	if (data == nullptr)
+		return;
+	// only whole pages can be released, so round inwards
+	size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	size_t first = ((size_t) (begin - data) + pageSize - 1) / pageSize * pageSize;
+	size_t last = (size_t) (end - data) / pageSize * pageSize;
+	if (last > first)
+		madvise(const_cast<char*>(data) + first, last - first, MADV_DONTNEED);
+#else
+	// windows trims the working set on its own
+	(void) begin;
+	(void) end;
+#endif
+	} // Discard()
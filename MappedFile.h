@@ -0,0 +1,58 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <cstddef>
+
+// read-only memory mapping of a whole file
+// the pages are owned by the OS, so several processes mapping the
+// same file share a single physical copy
+class MappedFile
+	{ // class MappedFile
+	public:
+	// constructor - starts out unmapped
+	MappedFile();
+	// destructor releases the mapping
+	~MappedFile();
+
+	// mappings own OS handles, so they cannot be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator =(const MappedFile&) = delete;
+
+	// map the named file, returns false on failure
+	bool Open(const char* fileName);
+
+	// release the mapping (safe to call when nothing is mapped)
+	void Close();
+
+	// first byte of the file (nullptr when nothing is mapped)
+	const char* Data() const { return data; }
+
+	// size of the file in bytes
+	size_t Size() const { return size; }
+
+	// one past the last byte of the file
+	const char* End() const { return data + size; }
+
+	// true if a file is currently mapped
+	bool IsOpen() const { return data != nullptr; }
+
+	// hint that the file will be read front to back
+	void AdviseSequential();
+
+	// hand the pages wholly inside [begin, end) back to the OS
+	// they are read back in from the file if they are touched again
+	void Discard(const char* begin, const char* end);
+
+	private:
+	// the mapped bytes and how many there are
+	const char* data;
+	size_t size;
+
+#ifdef _WIN32
+	// windows needs both the file and the mapping object kept open
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+	}; // class MappedFile
+
+#endif
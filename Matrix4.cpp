@@ -5,6 +5,58 @@
 #include "Matrix4.h"
 #include <math.h>
 
+// the products and transforms below use SSE or NEON when the compiler targets them,
+// and plain loops otherwise (or when MATRIX4_SCALAR is defined)
+// every path adds the same products in the same order, starting from zero,
+// so all of them give bit-for-bit the same results
+#if !defined(MATRIX4_SCALAR) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define MATRIX4_SSE
+#include <xmmintrin.h>
+#elif !defined(MATRIX4_SCALAR) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define MATRIX4_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(MATRIX4_SSE)
+// load the columns of a row-major matrix, for transforming vectors
+static inline void LoadColumns(const float (&coordinates)[4][4], __m128 (&column)[4])
+    { // LoadColumns()
+    for (int row = 0; row < 4; row++)
+        column[row] = _mm_loadu_ps(coordinates[row]);
+    _MM_TRANSPOSE4_PS(column[0], column[1], column[2], column[3]);
+    } // LoadColumns()
+
+// multiply a vector by a matrix given as its columns
+static inline __m128 TransformColumns(const __m128 (&column)[4], __m128 vector)
+    { // TransformColumns()
+    __m128 product = _mm_setzero_ps();
+    product = _mm_add_ps(product, _mm_mul_ps(column[0], _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(0, 0, 0, 0))));
+    product = _mm_add_ps(product, _mm_mul_ps(column[1], _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(1, 1, 1, 1))));
+    product = _mm_add_ps(product, _mm_mul_ps(column[2], _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(2, 2, 2, 2))));
+    product = _mm_add_ps(product, _mm_mul_ps(column[3], _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(3, 3, 3, 3))));
+    return product;
+    } // TransformColumns()
+#elif defined(MATRIX4_NEON)
+// load the columns of a row-major matrix, for transforming vectors
+static inline void LoadColumns(const float (&coordinates)[4][4], float32x4_t (&column)[4])
+    { // LoadColumns()
+    float32x4x4_t columns = vld4q_f32(&coordinates[0][0]);
+    for (int col = 0; col < 4; col++)
+        column[col] = columns.val[col];
+    } // LoadColumns()
+
+// multiply a vector by a matrix given as its columns
+static inline float32x4_t TransformColumns(const float32x4_t (&column)[4], float32x4_t vector)
+    { // TransformColumns()
+    float32x4_t product = vdupq_n_f32(0.0f);
+    product = vaddq_f32(product, vmulq_n_f32(column[0], vgetq_lane_f32(vector, 0)));
+    product = vaddq_f32(product, vmulq_n_f32(column[1], vgetq_lane_f32(vector, 1)));
+    product = vaddq_f32(product, vmulq_n_f32(column[2], vgetq_lane_f32(vector, 2)));
+    product = vaddq_f32(product, vmulq_n_f32(column[3], vgetq_lane_f32(vector, 3)));
+    return product;
+    } // TransformColumns()
+#endif
+
 // constructor - default to the zero matrix
 Matrix4::Matrix4()
     { // default constructor
@@ -59,18 +111,40 @@ Matrix4 Matrix4::operator *(float factor) const
 // multiplication is the only operator we use
 Homogeneous4 Matrix4::operator *(const Homogeneous4 &vector) const
     { // operator *()
-    // get a zero-initialised vector
     Homogeneous4 productVector;
-    
-    // now loop, adding products
-    for (int row = 0; row < 4; row++)
-        for (int col = 0; col < 4; col++)
-            productVector[row] += coordinates[row][col] * vector[col];
-    
-    // return the result
+    Transform(&vector, &productVector, 1);
     return productVector;
     } // operator *()
 
+// batched transform of an array of homogeneous points
+// (in and out may be the same array)
+void Matrix4::Transform(const Homogeneous4 *in, Homogeneous4 *out, size_t count) const
+    { // Transform()
+#if defined(MATRIX4_SSE)
+    // the columns only need to be pulled out once for the whole array
+    __m128 column[4];
+    LoadColumns(coordinates, column);
+    for (size_t i = 0; i < count; i++)
+        _mm_storeu_ps(&out[i].x, TransformColumns(column, _mm_loadu_ps(&in[i].x)));
+#elif defined(MATRIX4_NEON)
+    float32x4_t column[4];
+    LoadColumns(coordinates, column);
+    for (size_t i = 0; i < count; i++)
+        vst1q_f32(&out[i].x, TransformColumns(column, vld1q_f32(&in[i].x)));
+#else
+    for (size_t i = 0; i < count; i++)
+        { // per point
+        // get a zero-initialised vector
+        Homogeneous4 productVector;
+        // now loop, adding products
+        for (int row = 0; row < 4; row++)
+            for (int col = 0; col < 4; col++)
+                productVector[row] += coordinates[row][col] * in[i][col];
+        out[i] = productVector;
+        } // per point
+#endif
+    } // Transform()
+
 
 // and on Cartesian coordinates
 Cartesian3 Matrix4::operator *(const Cartesian3 &vector) const
@@ -118,12 +192,37 @@ Matrix4 Matrix4::operator *(const Matrix4 &other) const
     { // operator *()
     // start with a zero matrix
     Matrix4 productMatrix;
-    
+
+#if defined(MATRIX4_SSE)
+    // each row of the product is a combination of the rows of the other matrix
+    __m128 otherRow[4];
+    for (int entry = 0; entry < 4; entry++)
+        otherRow[entry] = _mm_loadu_ps(other.coordinates[entry]);
+    for (int row = 0; row < 4; row++)
+        { // per row
+        __m128 productRow = _mm_setzero_ps();
+        for (int entry = 0; entry < 4; entry++)
+            productRow = _mm_add_ps(productRow, _mm_mul_ps(_mm_set1_ps(coordinates[row][entry]), otherRow[entry]));
+        _mm_storeu_ps(productMatrix.coordinates[row], productRow);
+        } // per row
+#elif defined(MATRIX4_NEON)
+    float32x4_t otherRow[4];
+    for (int entry = 0; entry < 4; entry++)
+        otherRow[entry] = vld1q_f32(other.coordinates[entry]);
+    for (int row = 0; row < 4; row++)
+        { // per row
+        float32x4_t productRow = vdupq_n_f32(0.0f);
+        for (int entry = 0; entry < 4; entry++)
+            productRow = vaddq_f32(productRow, vmulq_n_f32(otherRow[entry], coordinates[row][entry]));
+        vst1q_f32(productMatrix.coordinates[row], productRow);
+        } // per row
+#else
     // now loop, adding products
     for (int row = 0; row < 4; row++)
         for (int col = 0; col < 4; col++)
             for (int entry = 0; entry < 4; entry++)
                 productMatrix.coordinates[row][col] += coordinates[row][entry] * other.coordinates[entry][col];
+#endif
 
     // return the result
     return productMatrix;
@@ -4,6 +4,7 @@
 #define MATRIX4_H
 
 #include <iostream>
+#include <cstddef>
 #include "Cartesian3.h"
 #include "Homogeneous4.h"
 #include <math.h>
@@ -54,6 +55,10 @@ class Matrix4
     // and on Cartesian coordinates
     Cartesian3 operator *(const Cartesian3 &vector) const;
 
+    // batched version of the homogeneous one above, for whole arrays of points
+    // (in and out may be the same array)
+    void Transform(const Homogeneous4 *in, Homogeneous4 *out, size_t count) const;
+
     // matrix operations
     // addition operator
     Matrix4 operator +(const Matrix4 &other) const;
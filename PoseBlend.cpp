@@ -0,0 +1,221 @@
+#include "PoseBlend.h"
+#include <cmath>
+
+// the blend runs on four quaternions at a time with SSE or NEON when the compiler
+// targets them, and on one at a time otherwise (or when POSE_BLEND_SCALAR is defined)
+#if !defined(POSE_BLEND_SCALAR) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#include <xmmintrin.h>
+typedef __m128 Lanes;
+static const int LANES = 4;
+static inline Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+static inline void Store(float* p, Lanes v) { _mm_storeu_ps(p, v); }
+static inline Lanes Splat(float v) { return _mm_set1_ps(v); }
+static inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+static inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+static inline Lanes Div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+static inline Lanes Sqrt(Lanes a) { return _mm_sqrt_ps(a); }
+static inline Lanes Abs(Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+// negate a wherever sign is negative
+static inline Lanes FlipSign(Lanes a, Lanes sign) { return _mm_xor_ps(a, _mm_and_ps(sign, _mm_set1_ps(-0.0f))); }
+#elif !defined(POSE_BLEND_SCALAR) && defined(__aarch64__)
+#include <arm_neon.h>
+typedef float32x4_t Lanes;
+static const int LANES = 4;
+static inline Lanes Load(const float* p) { return vld1q_f32(p); }
+static inline void Store(float* p, Lanes v) { vst1q_f32(p, v); }
+static inline Lanes Splat(float v) { return vdupq_n_f32(v); }
+static inline Lanes Add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+static inline Lanes Sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+static inline Lanes Mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+static inline Lanes Div(Lanes a, Lanes b) { return vdivq_f32(a, b); }
+static inline Lanes Sqrt(Lanes a) { return vsqrtq_f32(a); }
+static inline Lanes Abs(Lanes a) { return vabsq_f32(a); }
+// negate a wherever sign is negative
+static inline Lanes FlipSign(Lanes a, Lanes sign)
+	{ // FlipSign()
+	uint32x4_t signBits = vandq_u32(vreinterpretq_u32_f32(sign), vdupq_n_u32(0x80000000u));
+	return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), signBits));
+	} // FlipSign()
+#else
+typedef float Lanes;
+static const int LANES = 1;
+static inline Lanes Load(const float* p) { return *p; }
+static inline void Store(float* p, Lanes v) { *p = v; }
+static inline Lanes Splat(float v) { return v; }
+static inline Lanes Add(Lanes a, Lanes b) { return a + b; }
+static inline Lanes Sub(Lanes a, Lanes b) { return a - b; }
+static inline Lanes Mul(Lanes a, Lanes b) { return a * b; }
+static inline Lanes Div(Lanes a, Lanes b) { return a / b; }
+static inline Lanes Sqrt(Lanes a) { return std::sqrt(a); }
+static inline Lanes Abs(Lanes a) { return std::fabs(a); }
+// negate a wherever sign is negative
+static inline Lanes FlipSign(Lanes a, Lanes sign) { return std::signbit(sign) ? -a : a; }
+#endif
+
+// above this cosine the two quaternions are so close (under 0.3 degrees apart) that
+// a lerp is indistinguishable from slerp, and acos is no longer accurate anyway
+static const float NEAR_COSINE = 0.99999f;
+
+// blend LANES quaternions: from, to and result point at the first of them in each
+// component array, and weights at their weights
+static inline void BlendLanes(const float* const from[4], const float* const to[4], const float* weights,
+	float* const result[4], int index, BlendAccuracy accuracy)
+	{ // BlendLanes()
+	Lanes a[4], b[4];
+	for (int component = 0; component < 4; component++)
+		{ // per component
+		a[component] = Load(from[component] + index);
+		b[component] = Load(to[component] + index);
+		} // per component
+	Lanes t = Load(weights);
+
+	// take the shorter way round by flipping the second quaternion where the dot product is negative
+	Lanes dot = Add(Add(Mul(a[0], b[0]), Mul(a[1], b[1])), Add(Mul(a[2], b[2]), Mul(a[3], b[3])));
+	for (int component = 0; component < 4; component++)
+		b[component] = FlipSign(b[component], dot);
+	dot = Abs(dot);
+
+	// work out how much of each input goes into the result
+	Lanes weightA, weightB;
+	if (accuracy == BLEND_FAST)
+		{ // corrected nlerp
+		// nlerp moves too slowly near the ends and too fast in the middle: bend the weight
+		// with a cubic in t, whose coefficients are fitted polynomials in the cosine
+		Lanes half = Sub(t, Splat(0.5f));
+		Lanes A = Add(Splat(1.0904f), Mul(dot, Add(Splat(-3.2452f), Mul(dot, Sub(Splat(3.55645f), Mul(dot, Splat(1.43519f)))))));
+		Lanes B = Add(Splat(0.848013f), Mul(dot, Add(Splat(-1.06021f), Mul(dot, Splat(0.215638f)))));
+		Lanes k = Add(Mul(A, Mul(half, half)), B);
+		Lanes corrected = Add(t, Mul(Mul(Mul(t, half), Sub(t, Splat(1.0f))), k));
+		weightA = Sub(Splat(1.0f), corrected);
+		weightB = corrected;
+		} // corrected nlerp
+	else
+		{ // exact slerp
+		// the trigonometry is done one lane at a time
+		float cosine[LANES], weight[LANES], wA[LANES], wB[LANES];
+		Store(cosine, dot);
+		Store(weight, t);
+		for (int lane = 0; lane < LANES; lane++)
+			{ // per lane
+			if (cosine[lane] > NEAR_COSINE)
+				{ // close enough to lerp
+				wA[lane] = 1.0f - weight[lane];
+				wB[lane] = weight[lane];
+				} // close enough to lerp
+			else
+				{ // true slerp
+				float theta = std::acos(std::fmin(cosine[lane], 1.0f));
+				float sine = std::sin(theta);
+				wA[lane] = std::sin((1.0f - weight[lane]) * theta) / sine;
+				wB[lane] = std::sin(weight[lane] * theta) / sine;
+				} // true slerp
+			} // per lane
+		weightA = Load(wA);
+		weightB = Load(wB);
+		} // exact slerp
+
+	// combine, and normalize (which also takes out the rounding of the slerp)
+	Lanes blended[4];
+	for (int component = 0; component < 4; component++)
+		blended[component] = Add(Mul(a[component], weightA), Mul(b[component], weightB));
+	Lanes lengthSquared = Add(Add(Mul(blended[0], blended[0]), Mul(blended[1], blended[1])),
+		Add(Mul(blended[2], blended[2]), Mul(blended[3], blended[3])));
+	Lanes scale = Div(Splat(1.0f), Sqrt(lengthSquared));
+	for (int component = 0; component < 4; component++)
+		Store(result[component] + index, Mul(blended[component], scale));
+	} // BlendLanes()
+
+// the common part of both versions: stride is 0 for a single weight, 1 for one per quaternion
+static void BlendRun(const float* const from[4], const float* const to[4], const float* weights, int stride,
+	float* const result[4], int count, BlendAccuracy accuracy)
+	{ // BlendRun()
+	// the same weight in every lane, if there is only one
+	float laneWeights[LANES];
+	for (int lane = 0; lane < LANES; lane++)
+		laneWeights[lane] = weights[0];
+
+	// whole groups of lanes straight out of the arrays
+	int index = 0;
+	for (; index + LANES <= count; index += LANES)
+		BlendLanes(from, to, (stride != 0) ? weights + index : laneWeights, result, index, accuracy);
+
+	// and the last few through a padded copy
+	if (index == count)
+		return;
+	float tail[3][4][LANES];
+	for (int component = 0; component < 4; component++)
+		for (int lane = 0; lane < LANES; lane++)
+			{ // per lane
+			bool used = index + lane < count;
+			// unused lanes get the identity, so they stay well-defined
+			float identity = (component == 0) ? 1.0f : 0.0f;
+			tail[0][component][lane] = used ? from[component][index + lane] : identity;
+			tail[1][component][lane] = used ? to[component][index + lane] : identity;
+			if (stride != 0)
+				laneWeights[lane] = used ? weights[index + lane] : 0.0f;
+			} // per lane
+	const float* tailFrom[4] = { tail[0][0], tail[0][1], tail[0][2], tail[0][3] };
+	const float* tailTo[4] = { tail[1][0], tail[1][1], tail[1][2], tail[1][3] };
+	float* tailResult[4] = { tail[2][0], tail[2][1], tail[2][2], tail[2][3] };
+	BlendLanes(tailFrom, tailTo, laneWeights, tailResult, 0, accuracy);
+	for (int component = 0; component < 4; component++)
+		for (int lane = 0; index + lane < count; lane++)
+			result[component][index + lane] = tail[2][component][lane];
+	} // BlendRun()
+
+// blend a run of quaternions with a single weight
+void BlendQuaternions(const float* const from[4], const float* const to[4], float weight,
+	float* const result[4], int count, BlendAccuracy accuracy)
+	{ // BlendQuaternions()
+	BlendRun(from, to, &weight, 0, result, count, accuracy);
+	} // BlendQuaternions()
+
+// the same with a weight per quaternion
+void BlendQuaternions(const float* const from[4], const float* const to[4], const float* weights,
+	float* const result[4], int count, BlendAccuracy accuracy)
+	{ // BlendQuaternions()
+	BlendRun(from, to, weights, 1, result, count, accuracy);
+	} // BlendQuaternions()
+
+// load LANES quaternions from four component arrays into a buffer of LANES per component,
+// of which only the first available exist: the rest of the lanes get the identity
+static inline void LoadLanes(const float* const rows[4], int index, int available, float (&lanes)[4][LANES])
+	{ // LoadLanes()
+	for (int component = 0; component < 4; component++)
+		for (int lane = 0; lane < LANES; lane++)
+			lanes[component][lane] = (lane < available) ? rows[component][index + lane] : (component == 0) ? 1.0f : 0.0f;
+	} // LoadLanes()
+
+// blend any number of runs of quaternions, folding them in one at a time, in one pass
+void BlendManyQuaternions(const float* const* inputs, const float* weights, int inputCount,
+	float* const result[4], int count, BlendAccuracy accuracy)
+	{ // BlendManyQuaternions()
+	if (inputCount <= 0)
+		return;
+	for (int index = 0; index < count; index += LANES)
+		{ // per group of lanes
+		int available = count - index;
+		// the blend so far starts as the first input, and each input after it is
+		// blended in by its share of the weight so far
+		float blended[4][LANES], next[4][LANES];
+		LoadLanes(inputs, index, available, blended);
+		float* blendedRows[4] = { blended[0], blended[1], blended[2], blended[3] };
+		const float* nextRows[4] = { next[0], next[1], next[2], next[3] };
+		float total = weights[0];
+		for (int input = 1; input < inputCount; input++)
+			{ // per input
+			total += weights[input];
+			float share[LANES];
+			for (int lane = 0; lane < LANES; lane++)
+				share[lane] = weights[input] / total;
+			LoadLanes(inputs + 4 * input, index, available, next);
+			BlendLanes(blendedRows, nextRows, share, blendedRows, 0, accuracy);
+			} // per input
+
+		// store as many lanes as there are
+		for (int component = 0; component < 4; component++)
+			for (int lane = 0; lane < LANES && lane < available; lane++)
+				result[component][index + lane] = blended[component][lane];
+		} // per group of lanes
+	} // BlendManyQuaternions()
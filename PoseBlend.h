@@ -0,0 +1,33 @@
+#ifndef _POSE_BLEND_H
+#define _POSE_BLEND_H
+
+// how accurately BlendQuaternions interpolates
+enum BlendAccuracy
+	{ // enum BlendAccuracy
+	// true slerp (constant angular velocity), within 3e-7 radians of a double precision slerp
+	BLEND_EXACT,
+	// nlerp with a cubic correction of the weight, and no transcendentals at all
+	// never more than 8e-4 radians (0.05 degrees) from the exact slerp
+	BLEND_FAST
+	}; // enum BlendAccuracy
+
+// blend a run of quaternions stored as four component arrays (w, x, y, z), laid out
+// like the orientation tracks, so a whole pose (or many poses back to back) is one call
+// every pair takes the shorter way round, and every result is normalized
+// the result arrays may be the same as either of the inputs
+void BlendQuaternions(const float* const from[4], const float* const to[4], float weight,
+	float* const result[4], int count, BlendAccuracy accuracy = BLEND_EXACT);
+
+// the same with a weight per quaternion, e.g. for several characters blending at once
+void BlendQuaternions(const float* const from[4], const float* const to[4], const float* weights,
+	float* const result[4], int count, BlendAccuracy accuracy = BLEND_EXACT);
+
+// blend any number of runs of quaternions in a single pass over the quaternions, where
+// inputs[4 * i + component] is the component array of input i: each input in turn is
+// blended into the result so far by its share of the weight so far, so two inputs give
+// exactly the BlendQuaternions result, and an input with next to no weight changes next to nothing
+// the weights must be positive; the result arrays may not be any of the inputs
+void BlendManyQuaternions(const float* const* inputs, const float* weights, int inputCount,
+	float* const result[4], int count, BlendAccuracy accuracy = BLEND_EXACT);
+
+#endif
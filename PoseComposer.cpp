@@ -0,0 +1,58 @@
+#include "PoseComposer.h"
+#include <algorithm>
+
+// set up for a rig, with every joint at the identity and due to be composed
+void PoseComposer::SetRig(const SkeletonHandle& rig)
+	{ // SetRig()
+	skeleton = rig;
+	int jointCount = rig ? rig->JointCount() : 0;
+	local.assign(jointCount, Affine3());
+	global.assign(jointCount, Affine3());
+	dirty.assign(jointCount, 1);
+	} // SetRig()
+
+// change the local transform of a joint, which only marks it dirty if it is different
+void PoseComposer::SetLocal(int joint, const Affine3& transform)
+	{ // SetLocal()
+	if (local[joint] == transform)
+		return;
+	local[joint] = transform;
+	dirty[joint] = 1;
+	} // SetLocal()
+
+// mark every joint dirty
+void PoseComposer::Invalidate()
+	{ // Invalidate()
+	std::fill(dirty.begin(), dirty.end(), 1);
+	} // Invalidate()
+
+// recompose every dirty joint and everything below it
+int PoseComposer::Update()
+	{ // Update()
+	int recomputed = 0;
+	int jointCount = skeleton ? dirty.size() : 0;
+	for (int joint = 0; joint < jointCount; )
+		{ // per joint
+		if (!dirty[joint])
+			{ // unchanged
+			joint++;
+			continue;
+			} // unchanged
+		// the descendants of a dirty joint are the joints up to its subtree end, and
+		// parents come first, so one pass over them recomposes the whole subtree
+		int end = skeleton->subtreeEnd[joint];
+		for (int descendant = joint; descendant < end; descendant++)
+			{ // per descendant
+			int parent = skeleton->parentBones[descendant];
+			global[descendant] = (parent < 0) ? local[descendant] : global[parent] * local[descendant];
+			dirty[descendant] = 0;
+			} // per descendant
+		recomputed += end - joint;
+		joint = end;
+		} // per joint
+
+	lastRecomputed = recomputed;
+	totalRecomputed += recomputed;
+	updates++;
+	return recomputed;
+	} // Update()
@@ -0,0 +1,48 @@
+#ifndef _POSE_COMPOSER_H
+#define _POSE_COMPOSER_H
+
+#include <cstdint>
+#include <vector>
+#include "Affine3.h"
+#include "Skeleton.h"
+
+// incremental forward kinematics: keeps the local and global transform of every joint
+// from one frame to the next, and only recomposes the subtrees under joints whose local
+// transform actually changed (e.g. one arm in a layer, or a leg adjusted by IK)
+class PoseComposer
+	{ // class PoseComposer
+	public:
+	// set up for a rig, with every joint at the identity and due to be composed
+	void SetRig(const SkeletonHandle& rig);
+	const SkeletonHandle& Rig() const { return skeleton; }
+
+	// change the local transform of a joint, which only marks it dirty if it is different
+	void SetLocal(int joint, const Affine3& local);
+
+	// mark every joint dirty, e.g. after the globals were changed behind our back
+	void Invalidate();
+
+	// recompose every dirty joint and everything below it, returning how many joints that was
+	int Update();
+
+	// the transforms of each joint; the globals are only up to date after Update
+	const Affine3& Local(int joint) const { return local[joint]; }
+	const Affine3* Globals() const { return global.data(); }
+
+	// counters: joints recomputed by the last Update, and over all of them
+	int LastRecomputed() const { return lastRecomputed; }
+	uint64_t TotalRecomputed() const { return totalRecomputed; }
+	uint64_t Updates() const { return updates; }
+
+	private:
+	SkeletonHandle skeleton;
+	std::vector<Affine3> local;
+	std::vector<Affine3> global;
+	// one flag per joint whose local transform changed since the last Update
+	std::vector<uint8_t> dirty;
+	int lastRecomputed = 0;
+	uint64_t totalRecomputed = 0;
+	uint64_t updates = 0;
+	}; // class PoseComposer
+
+#endif
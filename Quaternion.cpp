@@ -64,6 +64,39 @@ Matrix4 Quaternion::ToRotationMatrix()
     return ret;
 }
 
+// The same without the bottom row, which is always 0 0 0 1
+Affine3 Quaternion::ToRotationAffine() const
+{
+    float x2  = x + x;
+    float y2  = y + y;
+    float z2  = z + z;
+    float xx2 = x * x2;
+    float xy2 = x * y2;
+    float xz2 = x * z2;
+    float yy2 = y * y2;
+    float yz2 = y * z2;
+    float zz2 = z * z2;
+    float sx2 = w * x2;
+    float sy2 = w * y2;
+    float sz2 = w * z2;
+
+    Affine3 ret;
+
+    ret.coordinates[0][0] = 1 - (yy2 + zz2);
+    ret.coordinates[1][0] = xy2 - sz2;
+    ret.coordinates[2][0] = xz2 + sy2;
+
+    ret.coordinates[0][1] = xy2 + sz2;
+    ret.coordinates[1][1] = 1 - (xx2 + zz2);
+    ret.coordinates[2][1] = yz2 - sx2;
+
+    ret.coordinates[0][2] = xz2 - sy2;
+    ret.coordinates[1][2] = yz2 + sx2;
+    ret.coordinates[2][2] = 1 - (xx2 + yy2);
+
+    return ret;
+}
+
 void Quaternion::Normalize()
 {
     float magnitude = sqrt(w*w + x*x + y*y + z*z);
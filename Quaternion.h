@@ -1,5 +1,9 @@
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
 #include <iostream>
 #include "Matrix4.h"
+#include "Affine3.h"
 // Quaternion class to do rotations using quaternions
 class Quaternion
 {
@@ -9,6 +13,7 @@ public:
     Quaternion(float angle, const Cartesian3& v); // Rotate by an angle around some axis
     Quaternion(float w, float x, float y, float z); // Set quaternion values
     Matrix4 ToRotationMatrix(); // Convert the quaternion to a rotation matrix
+    Affine3 ToRotationAffine() const; // The same as an affine transform with no translation
     void Normalize(); // Normalize the quaternion 
     Quaternion Conjugate(); // Get the conjugate of the quaternion
     Quaternion operator*(float f) const;
@@ -45,6 +50,12 @@ inline Quaternion operator*(float f, const Quaternion& q) {
 }
 
 
+// Linearly interpolate between two positions
+inline Cartesian3 Lerp(const Cartesian3& a, const Cartesian3& b, float t)
+{
+    return a + (b - a) * t;
+}
+
 inline Quaternion Slerp(Quaternion q1, Quaternion q2, float t)
 {
     // Compute the cosine of the angle between the two vectors.
@@ -86,3 +97,5 @@ inline Quaternion Slerp(Quaternion q1, Quaternion q2, float t)
     // result.Normalize();
     // return result;
 }
+
+#endif
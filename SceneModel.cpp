@@ -2,6 +2,7 @@
 
 #include "SceneModel.h"
 #include <math.h>
+#include <iomanip>
 
 // three local variables with the hardcoded file names
 const char* groundModelName		= "./models/randomland.dem";
@@ -21,8 +22,6 @@ const GLfloat sunAmbient[4] = {0.1, 0.1, 0.1, 1.0 };
 const GLfloat sunDiffuse[4] = {0.7, 0.7, 0.7, 1.0 };
 const GLfloat blackColour[4] = {0.0, 0.0, 0.0, 1.0};
 
-static auto startTime = std::chrono::high_resolution_clock::now();
-
 // constructor
 SceneModel::SceneModel()
 	{ // constructor
@@ -30,11 +29,40 @@ SceneModel::SceneModel()
 	groundModel.ReadFileTerrainData(groundModelName, 20);
 
 	// load the animation data from files
-	restPose.ReadFileBVH(motionBvhStand);
-	runCycle.ReadFileBVH(motionBvhRun);
-	veerLeftCycle.ReadFileBVH(motionBvhveerLeft);
-	veerRightCycle.ReadFileBVH(motionBvhveerRight);
-	playerController.ReadFileBVH(motionBvhRun);
+	// each clip goes through its compiled .bvhc cache, so only the first run parses text
+	// the run cycle defines the rig, and every other clip is checked against it and shares it
+	// the run cycle loops for as long as the app runs, so compose all its frames once
+	// the player is drawn between frames, so every clip gets its cubic coefficients too
+	std::shared_ptr<BVHData> run = std::make_shared<BVHData>();
+	if (run->LoadClip(motionBvhRun))
+		{ // loaded
+		if (run->BuildPoseCache(1.0f))
+			std::cout << "Pose cache for " << motionBvhRun << ": " << run->PoseCacheBytes() << " bytes" << std::endl;
+		run->BuildCubicTracks();
+		runCycle = run;
+		} // loaded
+	SkeletonHandle rig = runCycle ? runCycle->skeleton : SkeletonHandle();
+	restPose = BVHData::Load(motionBvhStand, rig, true);
+	veerLeftCycle = BVHData::Load(motionBvhveerLeft, rig, true);
+	veerRightCycle = BVHData::Load(motionBvhveerRight, rig, true);
+	// the run cycle was compiled just above, so this maps the cache rather than parsing again
+	playerController.LoadClip(motionBvhRun, rig);
+	playerController.sampleMode = SAMPLE_CUBIC;
+	playerController.boneRenderer = &boneRenderer;
+
+	// the player's states, in the order of CharacterState, each cross-fading
+	// into any other over half a second
+	playerStates.AddState("Running", runCycle);
+	playerStates.AddState("TurnLeft", veerLeftCycle);
+	playerStates.AddState("TurnRight", veerRightCycle);
+	playerStates.AddState("Idle", restPose);
+	for (int state = Running; state <= Idle; state++)
+		playerStates.AddTransition(ANY_STATE, state, 0.5f);
+	playerStates.Compile();
+	m_playerState = playerStates.Start(Running);
+
+	// the joint whose turn is handed on to the player
+	m_hipsJoint = rig ? rig->RoleJoint(ROLE_HIPS) : -1;
 
 	// set the world to opengl matrix
 	world2OpenGLMatrix = Matrix4::RotateX(90.0); // ccw rotation 
@@ -47,16 +75,14 @@ SceneModel::SceneModel()
 	// initialize the character's position and rotation
 	EventCharacterReset();
 
-	// and set the frame number to 0
-	frameNumber = 0;
-
 	// Set the character start position and direction
 	m_playerposition = Cartesian3(0.0f, 0.0f, 0.0f);
 	m_playerdirection = Cartesian3(0.0f, 0.0f, 1.0f);
 	//m_characterDirection.Rotate(135.92f, Cartesian3(0.0f, 1.0f, 0.0f));
 
 	// Construct the player look marix using current character position and direction
-	m_playerLookMatrix = Matrix4::Look(m_playerposition, m_playerposition + m_playerdirection, Cartesian3(0.0f, 1.0f, 0.0f));
+	m_playerLookMatrix = Affine3::Look(m_playerposition, m_playerposition + m_playerdirection, Cartesian3(0.0f, 1.0f, 0.0f));
+	m_previousPlayerPosition = m_playerposition;
 
 	// Set the starting position of the character which is constantly running using the run animation
 	m_controllerLessRunCyclePosition = Cartesian3(30.0f, 0.0f, -10.0f);
@@ -73,16 +99,31 @@ SceneModel::~SceneModel()
 }
 
 // routine that updates the scene for the next frame
+// this runs as many fixed simulation steps as the clock says are due
 void SceneModel::Update()
 	{ // Update()
-	
+	// one look at the wall clock per tick, however many steps it adds up to
+	int due = clock.Tick();
+	for (int step = 0; step < due; step++)
+		Step(clock.Step(), clock.Time() - (due - 1 - step) * clock.Step());
+
+	// Update the camera 
+	m_camera->Update();
+	} // Update()
+
+// advance the simulation by one fixed step of dt seconds, ending at the given time
+void SceneModel::Step(double dt, double time)
+	{ // Step()
+	// remember where the player was, for Render to interpolate from
+	m_previousPlayerPosition = m_playerposition;
+
 	// get the height of the floor at the point the character is currently at
 	//auto playerground = groundModel.getHeight(m_playerposition.x, m_playerposition.z);
 	m_playerposition.y = 0.0f; // set y to the floor height for the character to make it run on the terrain instead of through
 
 	// Construct and update the look matrix for the character so it orients and moves correctly in the scene
 	// when the user makes changes
-	m_playerLookMatrix = Matrix4::Look(m_playerposition, m_playerposition + m_playerdirection, Cartesian3(0.0f, 1.0f, 0.0f));
+	m_playerLookMatrix = Affine3::Look(m_playerposition, m_playerposition + m_playerdirection, Cartesian3(0.0f, 1.0f, 0.0f));
 
 	// Get the height of the terrain for the position of the run cycle animation loop character
 	auto runCycleFloor = groundModel.getHeight(m_controllerLessRunCyclePosition.x, m_controllerLessRunCyclePosition.z);
@@ -97,21 +138,34 @@ void SceneModel::Update()
 		m_controllerLessRunCyclePosition.z = -20.0f;
 	}
 
+	// take up any change of state, and advance the cross-fade
+	playerStates.Update(&m_playerState, 1, (float) dt);
+
+	// when a veer completes, the player carries on in the direction it turned to
+	const ClipHandle& playing = playerStates.StateClip(m_playerState.current);
+	if((m_playerState.current == TurnLeft || m_playerState.current == TurnRight) && playing && m_hipsJoint >= 0)
+	{
+		const BVHData& BVH = *playing;
+		int frame = BVH.FrameAtTime(time);
+		// only on the step that reaches the last frame
+		if(frame == BVH.frame_count - 1 && BVH.FrameAtTime(time - dt) != frame)
+		{
+			auto a = BVH.SampleAnimation(frame, m_hipsJoint);
+			std::cout << "player pos: " << m_playerposition << std::endl;
+			m_playerdirection.Rotate(a.y, Cartesian3(0.0f, 1.0f, 0.0f));
+			m_playerdirection = m_playerdirection.unit();
+		}
+	}
+
 	// Keep the player running in all states except idle
-	if(playerController.m_AnimState != Idle)
+	if(m_playerState.current != Idle)
 	{
 		// get the forward directon of the player and use it to move hte player in the forward direction 
 		auto forward = Cartesian3(m_playerLookMatrix[0][2], m_playerLookMatrix[1][2], m_playerLookMatrix[2][2]);
 		m_playerposition = m_playerposition + forward * playerSpeed;
 	}
 
-	// Update the camera 
-	m_camera->Update();
-
-	// increment the frame counter
-	frameNumber++;
-	
-	} // Update()
+	} // Step()
 
 
 // routine to tell the scene to render itself
@@ -172,75 +226,31 @@ void SceneModel::Render()
 	glMaterialfv(GL_FRONT, GL_SPECULAR, blackColour);
 	glMaterialfv(GL_FRONT, GL_EMISSION, blackColour);
 
-	// render the terrain
+	// render the terrain, out of its buffers if it has them
 	auto groundMatrix = m_camera->GetViewMatrix() * world2OpenGLMatrix;
-	groundModel.Render(groundMatrix);
+	if (groundRenderer.Ready())
+		groundRenderer.Draw(groundMatrix);
+	else
+		groundModel.Render(groundMatrix);
 	
 	// now set the colour to draw the bones
 	glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, boneColour);	
+	boneRenderer.Begin();
 
-	// duration since application started
-	auto currentTime = std::chrono::high_resolution_clock::now();
-	double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(currentTime - startTime).count();
-	double duration = nanoseconds / 1e+9;
+	// the clips play by simulation time, sampled part way between the last two steps,
+	// at the same point the player's position is interpolated to below
+	playerStates.InputsAtTime(m_playerState, clock.RenderTime(), m_playerInputs);
 
 	// Player controller
 	glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, playerColour);
 	// Set the player matrix for movement in the world. This will allow the player to move and look
-	auto playerControllerMatrix = m_camera->GetViewMatrix() * Matrix4::Translate(m_playerposition) * m_playerLookMatrix * world2OpenGLMatrix * Matrix4::RotateX(-90.0f);
-	playerController.Render(playerControllerMatrix, 1.0f, frameNumber, duration, m_playerposition, m_playerdirection, m_playerLookMatrix);
+	// (interpolating between where the player was at the last two steps)
+	Cartesian3 playerPosition = Lerp(m_previousPlayerPosition, m_playerposition, (float) clock.Alpha());
+	auto playerControllerMatrix = m_camera->GetViewMatrix() * (Affine3::Translate(playerPosition) * m_playerLookMatrix) * world2OpenGLMatrix * Matrix4::RotateX(-90.0f);
+	playerController.Render(playerControllerMatrix, 1.0f, m_playerInputs);
 
-	// Switch the animation being rendered based on the current state of the player
-	switch (playerController.m_AnimState)
-	{
-		// If the player is running, render the running animation
-		case Running:
-			if(playerController.m_currentState != Running)
-			{
-				playerController.timeStart = std::chrono::high_resolution_clock::now(); // provide current time when animation started
-				playerController.isTransitioningBack = true; // running is base state, tranitioning back will just go from the current animation state to the base animaiton
-				playerController.m_currentState = Running; // update the current animation state
-			}
-			break;
-		// If the player is turning left, push the turning left animation to transition to it
-		// and set the relevant states
-		case TurnLeft:
-			if(playerController.m_currentState != TurnLeft)
-			{
-				// set the current time so we know when the current animation started playing, this is needed for blending
-				playerController.timeStart = std::chrono::high_resolution_clock::now(); // provide current time when animation started
-				playerController.transitionTo.push_back(veerLeftCycle); // provide the relevant animation to transition to
-				playerController.isTransitioningBack = false; // set this to false since we will moving out of the run state
-				playerController.m_currentState = TurnLeft; // set the current state to the new state to prevent pushing more of the same anim
-			}
-			break;
-		// If the player is turning right, push the turning left animation to transition to it
-		// and set the relevant states
-		case TurnRight:
-			if(playerController.m_currentState != TurnRight)
-			{
-				// set the current time so we know when the current animation started playing, this is needed for blending
-				playerController.timeStart = std::chrono::high_resolution_clock::now(); // provide current time when animation started
-				playerController.transitionTo.push_back(veerRightCycle); // provide the relevant animation to transition to
-				playerController.isTransitioningBack = false; // set this to false since we will moving out of the run state
-				playerController.m_currentState = TurnRight; // set the current state to the new state to prevent pushing more of the same anim
-			}
-			break;
-		// Check if the player is changing to idle state. If so, push the idle animation to transition to which will 
-		// transiton the player to the idle state
-		case Idle:
-			if(playerController.m_currentState != Idle)
-			{
-				// set the current time so we know when the current animation started playing, this is needed for blending
-				playerController.timeStart = std::chrono::high_resolution_clock::now(); // provide current time when animation started
-				playerController.transitionTo.push_back(restPose); // provide the relevant animation to transition to
-				playerController.isTransitioningBack = false; // set this to false since we will moving out of the run state
-				playerController.m_currentState = Idle; // set the current state to the new state to prevent pushing more of the same anim
-			}
-			break;
-		default:
-			break;
-	}
+	// then every character's bones at once
+	boneRenderer.Draw();
 
 	// Debug purposes: Draw view matrix in the scene 
 	// auto start = Cartesian3(0.0f, 0.0f, 0.0f);
@@ -249,6 +259,24 @@ void SceneModel::Render()
 
 	} // Render()	
 
+// set up what the scene keeps in the GL context
+void SceneModel::InitialiseGL(GLProcLoader loader)
+	{ // InitialiseGL()
+	// without instancing, each character draws its own bones from the CPU instead
+	if (!boneRenderer.Initialise(loader))
+		std::cout << "Instanced bones are not available, drawing them from the CPU" << std::endl;
+	// the terrain never changes, so it is uploaded once
+	if (!groundRenderer.Initialise(loader, groundModel))
+		std::cout << "Terrain buffers are not available, drawing it from the CPU" << std::endl;
+	} // InitialiseGL()
+
+// and tear it down
+void SceneModel::ReleaseGL()
+	{ // ReleaseGL()
+	boneRenderer.Release();
+	groundRenderer.Release();
+	} // ReleaseGL()
+
 // camera control events: WASD for motion
 void SceneModel::EventCameraForward()
 	{ // EventCameraForward()
@@ -309,30 +337,31 @@ void SceneModel::EventCameraTurnRight()
 // character motion events: arrow keys for forward, backward, veer left & right
 void SceneModel::EventCharacterTurnLeft()
 	{ // EventCharacterTurnLeft()
-		playerController.m_AnimState = TurnLeft; // set the animation state of the player
+		AnimationStateMachine::Request(m_playerState, TurnLeft); // set the animation state of the player
 	} // EventCharacterTurnLeft()
 	
 void SceneModel::EventCharacterTurnRight()
 	{ // EventCharacterTurnRight()
-		playerController.m_AnimState = TurnRight; // set the new animation state of the player
+		AnimationStateMachine::Request(m_playerState, TurnRight); // set the new animation state of the player
 		// m_playerdirection.Rotate(3.0f, Cartesian3(0.0f, 1.0f, 0.0f));
 	} // EventCharacterTurnRight()
 	
 void SceneModel::EventCharacterForward()
 	{ // EventCharacterForward()
-		playerController.m_AnimState = Running; // set the animation state of the player
+		AnimationStateMachine::Request(m_playerState, Running); // set the animation state of the player
 	} // EventCharacterForward()
 	
 void SceneModel::EventCharacterBackward()
 	{ // EventCharacterBackward()
-		playerController.m_AnimState = Idle;
+		AnimationStateMachine::Request(m_playerState, Idle);
 	} // EventCharacterBackward()
 
 // reset character to original position: p
 void SceneModel::EventCharacterReset()
 	{ // EventCharacterReset()
 	m_playerposition = Cartesian3(0, 0, 0);
-	m_playerLookMatrix = Matrix4::Identity(); 
+	m_previousPlayerPosition = m_playerposition;
+	m_playerLookMatrix = Affine3::Identity(); 
 	m_playerdirection = Cartesian3(0.0f, 0.0f, 1.0f); // reset the direction of the character 
-	playerController.m_AnimState = Running; // set the animation to be idle
+	AnimationStateMachine::Request(m_playerState, Running); // set the animation to be idle
 	} // EventCharacterReset()
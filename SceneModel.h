@@ -15,30 +15,50 @@
 #include <GL/glu.h>
 #endif
 #include "Terrain.h"
+#include "SurfaceRenderer.h"
 #include "BVHData.h"
+#include "AnimationStateMachine.h"
+#include "SimulationClock.h"
 #include "Matrix4.h"
+#include "Affine3.h"
 #include "Camera.h"
 #include <memory.h>
 #include <chrono>
 
 // Define enum to set the animation state of the player
-// we can then use this to switch to the correct animation depending on the state
+// these are the states of the player's state machine, added in this order
+enum CharacterState
+{
+	Running,
+	TurnLeft,
+	TurnRight,
+	Idle
+};
 
 class SceneModel										
 	{ // class SceneModel
 	public:	
 	// a terrain model 
 	Terrain groundModel;
+	// the terrain kept in the GL context, once it is initialised
+	SurfaceRenderer groundRenderer;
 
 	// animation cycles (which implicitly have geometric data for a character)
-	BVHData restPose;
-	BVHData runCycle;
-	BVHData veerLeftCycle;
-	BVHData veerRightCycle;
+	// shared read-only, so handing one to the player never copies it
+	ClipHandle restPose;
+	ClipHandle runCycle;
+	ClipHandle veerLeftCycle;
+	ClipHandle veerRightCycle;
 
 	// seperate bvh for the player/character
 	BVHData playerController;
 
+	// draws the bones of every character in one instanced call, once it is initialised
+	BoneRenderer boneRenderer;
+
+	// which clip the player plays in each state, and how it gets from one to another
+	AnimationStateMachine playerStates;
+
 	// location & orientation of character
 	Cartesian3 characterLocation;
 	Matrix4 characterRotation;
@@ -52,8 +72,8 @@ class SceneModel
 	Matrix4 CameraTranslateMatrix;
 	Matrix4 CameraRotationMatrix;
 	
-	// the frame number for use in animating
-	unsigned long frameNumber;
+	// the simulation runs in fixed steps of this clock, however often Update is called
+	SimulationClock clock;
 	
 	// constructor
 	SceneModel();
@@ -61,11 +81,19 @@ class SceneModel
 	~SceneModel();
 
 	// routine that updates the scene for the next frame
+	// this runs as many fixed simulation steps as the clock says are due
 	void Update();
 
+	// advance the simulation by one fixed step of dt seconds, ending at the given time
+	void Step(double dt, double time);
+
 	// routine to tell the scene to render itself
 	void Render();
 
+	// set up and tear down what the scene keeps in the GL context, with it current
+	void InitialiseGL(GLProcLoader loader);
+	void ReleaseGL();
+
 	// camera control events: WASD for motion
 	void EventCameraForward();
 	void EventCameraLeft();
@@ -94,14 +122,20 @@ class SceneModel
 	Cartesian3 m_playerposition;
 	Cartesian3 m_playerdirection;
 	// look matrix for the player to have him move in the direction it's facing
-	Matrix4 m_playerLookMatrix;
+	Affine3 m_playerLookMatrix;
 	// scene camera
 	Camera* m_camera;
 
 	// position of the repeating running cycle 
 	Cartesian3 m_controllerLessRunCyclePosition;
 	// current animation state of the player/character
-
+	AnimationStateInstance m_playerState;
+	// the clips the player is blending this frame
+	std::vector<BlendInput> m_playerInputs;
+	// the hips, whose turn is applied to the player at the end of a veer
+	int m_hipsJoint;
+	// where the player was at the step before last, for Render to interpolate from
+	Cartesian3 m_previousPlayerPosition;
 	}; // class SceneModel
 
 #endif
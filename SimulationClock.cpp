@@ -0,0 +1,44 @@
+#include "SimulationClock.h"
+
+#include <cmath>
+
+// constructor - the step is in seconds
+SimulationClock::SimulationClock(double step)
+	: step(step), accumulator(0.0), steps(0), started(false)
+	{ // constructor
+	} // constructor
+
+// sample the wall clock, returning how many steps are now due
+int SimulationClock::Tick()
+	{ // Tick()
+	// the only call to the wall clock per tick
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!started)
+		{ // first tick
+		started = true;
+		lastTick = now;
+		return 0;
+		} // first tick
+	double elapsed = std::chrono::duration<double>(now - lastTick).count();
+	lastTick = now;
+	return Advance(elapsed);
+	} // Tick()
+
+// the same for a given amount of elapsed time
+int SimulationClock::Advance(double seconds)
+	{ // Advance()
+	if (seconds > 0.0)
+		accumulator += seconds;
+	int due = 0;
+	while (accumulator >= step && due < MAX_STEPS_PER_TICK)
+		{ // per step
+		accumulator -= step;
+		due++;
+		} // per step
+	// whole steps beyond the cap are dropped, rather than run later, but the
+	// fraction of a step is kept so rendering stays in phase
+	if (accumulator >= step)
+		accumulator = std::fmod(accumulator, step);
+	steps += due;
+	return due;
+	} // Advance()
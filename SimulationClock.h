@@ -0,0 +1,54 @@
+#ifndef _SIMULATION_CLOCK_H
+#define _SIMULATION_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+// the default simulation step, which is the rate the clips are recorded at
+const double SIMULATION_STEP = 1.0 / 24.0;
+
+// never run more steps than this for one tick, so that a long stall (a debugger,
+// a window drag) slows the simulation down rather than making it spiral; the whole
+// steps beyond the cap are dropped, but the fraction of a step left over is kept
+const int MAX_STEPS_PER_TICK = 8;
+
+// a fixed-timestep clock: the wall clock is sampled once per tick, the time since the
+// last tick goes into an accumulator, and the simulation advances in whole steps of
+// it, however often the ticks come; what is left over says how far rendering is
+// between the last two steps, so it is drawn one step behind the simulation
+class SimulationClock
+	{ // class SimulationClock
+	public:
+	// constructor - the step is in seconds
+	explicit SimulationClock(double step = SIMULATION_STEP);
+
+	// sample the wall clock, returning how many steps are now due
+	// the first tick only starts the clock
+	int Tick();
+
+	// the same for a given amount of elapsed time, e.g. when replaying
+	int Advance(double seconds);
+
+	// the length of a step
+	double Step() const { return step; }
+
+	// how many steps have been run, and the simulation time after them
+	uint64_t Steps() const { return steps; }
+	double Time() const { return steps * step; }
+
+	// how far rendering is from the step before last towards the last step, 0 to 1
+	double Alpha() const { return accumulator / step; }
+
+	// the simulation time that goes with Alpha(), between the last two steps, so that
+	// anything sampled at it lines up with state interpolated by Alpha()
+	double RenderTime() const { return steps ? Time() - step + accumulator : 0.0; }
+
+	private:
+	double step;
+	double accumulator;
+	uint64_t steps;
+	bool started;
+	std::chrono::steady_clock::time_point lastTick;
+	}; // class SimulationClock
+
+#endif
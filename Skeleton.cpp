@@ -0,0 +1,210 @@
+#include "Skeleton.h"
+#include <algorithm>
+#include <mutex>
+
+// FNV-1a, 64 bit
+static const uint64_t HASH_OFFSET = 14695981039346656037ull;
+static const uint64_t HASH_PRIME = 1099511628211ull;
+
+// fold some bytes into a hash
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+	{ // HashBytes()
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * HASH_PRIME;
+	} // HashBytes()
+
+// constructor - starts out empty
+Skeleton::Skeleton()
+	: topologyHash(HASH_OFFSET)
+	{ // constructor
+	for (int role = 0; role < JOINT_ROLE_COUNT; role++)
+		roleJoints[role] = -1;
+	} // constructor
+
+// recursive descent parser for the hierarchy, appending joints under the given parent
+bool Skeleton::ReadHierarchy(BVHTokenizer& tokenizer, std::vector<std::string_view>& line, int parent)
+	{ // ReadHierarchy()
+	// the new joint goes on the end, so it comes after its parent
+	// the second token (#1) will be the name of the joint
+	int joint = AddJoint(line[1], parent, Cartesian3(0.0f, 0.0f, 0.0f));
+	// read in the next line & tokenise it
+	if (!tokenizer.NextLine(line))
+		return false;
+	// if the beginning of the line is a left brace, we're starting a group of children
+	if (line[0] == "{")
+		{ // group of children
+		// ignore the rest of the line and read in a new one
+		if (!tokenizer.NextLine(line))
+			return false;
+		while (line[0] != "}")
+			{ // until we hit the close of the group
+			// The first token tells us which type of line
+			// OFFSET is the offset from the parent
+			if (line[0] == "OFFSET")
+				{
+				if (line.size() < 4)
+					return false;
+				for (int i = 0; i < 3; i++)
+					if (!BVHTokenizer::ParseFloat(line[i + 1], boneTranslations[joint][i]))
+						return false;
+				}
+			// CHANNELS defines how many floats are needed for the animation, and which ones
+			else if (line[0] == "CHANNELS")
+				{ // channel information
+				int nChannels = 0;
+				if (line.size() < 2 || !BVHTokenizer::ParseInt(line[1], nChannels) || (int) line.size() < nChannels + 2)
+					return false;
+				for (int i = 0; i < nChannels; i++)
+					jointChannels[joint].push_back(std::string(line[i + 2]));
+				} // channel information
+			// JOINT defines a new joint
+			else if (line[0] == "JOINT")
+				{ // joint information
+				if (line.size() < 2)
+					return false;
+				if (!ReadHierarchy(tokenizer, line, joint))
+					return false;
+				} // joint information 
+			// At the leaf of the hierarchy, there is no joint. Instead it says End 
+			else if (line[0] == "End")
+				{ // end site
+				// read in and ignore three extra lines
+				for (int i = 0; i < 3; i++) 
+					tokenizer.NextLine(line);
+				} // end site
+			// always read the next line when done processing this line
+			if (!tokenizer.NextLine(line))
+				return false;
+			} // until we hit the close of the group
+		} // group of children
+	return true;
+	} // ReadHierarchy()
+
+// append a joint (its parent must already be there), returning its index
+int Skeleton::AddJoint(std::string_view name, int parent, const Cartesian3& offset)
+	{ // AddJoint()
+	Bones.push_back(std::string(name));
+	parentBones.push_back(parent);
+	boneTranslations.push_back(offset);
+	jointChannels.emplace_back();
+	return Bones.size() - 1;
+	} // AddJoint()
+
+// once all the joints are in, set up everything that is derived from them
+void Skeleton::Finish(const RoleMap& roles)
+	{ // Finish()
+	int nJoints = JointCount();
+
+	// parents come first, so walking backwards pushes each subtree's end up to its parent
+	subtreeEnd.resize(nJoints);
+	for (int joint = 0; joint < nJoints; joint++)
+		subtreeEnd[joint] = joint + 1;
+	for (int joint = nJoints - 1; joint > 0; joint--)
+		if (parentBones[joint] >= 0)
+			subtreeEnd[parentBones[joint]] = std::max(subtreeEnd[parentBones[joint]], subtreeEnd[joint]);
+
+	// then compile the channels and hash the layout, one joint at a time
+	channelMap.clear();
+	topologyHash = HASH_OFFSET;
+	int firstChannel = 0;
+	for (int joint = 0; joint < nJoints; joint++)
+		{ // per joint
+		channelMap.push_back(CompileJointChannels(jointChannels[joint], firstChannel));
+		firstChannel += jointChannels[joint].size();
+
+		int32_t parent = parentBones[joint];
+		HashBytes(topologyHash, &parent, sizeof(parent));
+		HashBytes(topologyHash, Bones[joint].data(), Bones[joint].size() + 1);
+		int32_t nChannels = jointChannels[joint].size();
+		HashBytes(topologyHash, &nChannels, sizeof(nChannels));
+		for (const std::string& channel : jointChannels[joint])
+			{ // per channel
+			int32_t code = ChannelCode(channel);
+			HashBytes(topologyHash, &code, sizeof(code));
+			} // per channel
+		} // per joint
+
+	ResolveRoles(roles);
+	} // Finish()
+
+// work out the role of every joint from its name through a retarget map
+void Skeleton::ResolveRoles(const RoleMap& roles)
+	{ // ResolveRoles()
+	for (int role = 0; role < JOINT_ROLE_COUNT; role++)
+		roleJoints[role] = -1;
+	jointRoles.assign(JointCount(), ROLE_NONE);
+	if (JointCount() > 0)
+		roleJoints[ROLE_ROOT] = 0;
+	for (int joint = 0; joint < JointCount(); joint++)
+		{ // per joint
+		JointRole role = RoleFromName(Bones[joint], roles.names, roles.count);
+		jointRoles[joint] = role;
+		// the first one in the file wins
+		if (role != ROLE_NONE && roleJoints[role] < 0)
+			roleJoints[role] = joint;
+		} // per joint
+	} // ResolveRoles()
+
+// total number of channels over all joints
+int Skeleton::CountChannels() const
+	{ // CountChannels()
+	if (channelMap.empty())
+		return 0;
+	return channelMap.back().firstChannel + channelMap.back().channelCount;
+	} // CountChannels()
+
+// forward kinematics: multiply each joint's local matrix onto its parent's global matrix
+// both arrays hold JointCount() matrices, and the root's parent is the identity
+void Skeleton::ComposePose(const Affine3* local, Affine3* global) const
+	{ // ComposePose()
+	// parents come first, so their global matrix is always ready
+	for (int joint = 0; joint < JointCount(); joint++)
+		{ // per joint
+		int parent = parentBones[joint];
+		global[joint] = (parent < 0) ? local[joint] : global[parent] * local[joint];
+		} // per joint
+	} // ComposePose()
+
+// same joints, parents and channels (everything the hash covers)
+bool Skeleton::SameTopology(const Skeleton& other) const
+	{ // SameTopology()
+	return topologyHash == other.topologyHash && parentBones == other.parentBones
+		&& Bones == other.Bones && jointChannels == other.jointChannels;
+	} // SameTopology()
+
+// and the same rest offsets as well
+bool Skeleton::SameRig(const Skeleton& other) const
+	{ // SameRig()
+	if (!SameTopology(other) || jointRoles != other.jointRoles)
+		return false;
+	for (int joint = 0; joint < JointCount(); joint++)
+		if (!(boneTranslations[joint] == other.boneTranslations[joint]))
+			return false;
+	return true;
+	} // SameRig()
+
+// the shared instance of the given rig: an identical one loaded earlier
+// if there is one still in use, otherwise this one, which is remembered
+SkeletonHandle Skeleton::Share(const std::shared_ptr<Skeleton>& skeleton)
+	{ // Share()
+	// every rig in use; clips may be loaded from several threads
+	static std::vector<std::weak_ptr<const Skeleton>> registry;
+	static std::mutex registryLock;
+
+	std::lock_guard<std::mutex> lock(registryLock);
+	for (size_t i = 0; i < registry.size(); )
+		{ // per rig
+		SkeletonHandle known = registry[i].lock();
+		if (!known)
+			{ // no longer used, so forget it
+			registry.erase(registry.begin() + i);
+			continue;
+			} // no longer used
+		if (known->SameRig(*skeleton))
+			return known;
+		i++;
+		} // per rig
+	registry.push_back(skeleton);
+	return skeleton;
+	} // Share()
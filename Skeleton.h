@@ -0,0 +1,92 @@
+#ifndef _SKELETON_H
+#define _SKELETON_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Cartesian3.h"
+#include "Affine3.h"
+#include "BVHTokenizer.h"
+#include "JointChannels.h"
+#include "JointRoles.h"
+
+// the rig a clip is recorded on: joint hierarchy, names, rest offsets and channel layout
+// joints are stored flat, in file order, so every parent comes before its children
+// and the descendants of joint i are exactly the joints [i + 1, subtreeEnd[i])
+// every clip on the same rig shares one read-only instance, so joint i means
+// the same bone in all of them
+class Skeleton
+	{ // class Skeleton
+	public:
+	// constructor - starts out empty
+	Skeleton();
+
+	// a vector to store all bones' name
+	std::vector<std::string> Bones;
+
+	// a vector to store the parent bone's id for each joint (-1 for the root)
+	std::vector<int> parentBones;
+
+	// a vector to store all bones' offsets from their parent
+	std::vector<Cartesian3> boneTranslations;
+
+	// the channel names of each joint, as listed in the file
+	std::vector<std::vector<std::string>> jointChannels;
+
+	// one past the last descendant of each joint
+	std::vector<int> subtreeEnd;
+
+	// the channel layout of each joint, compiled from the joint's channel names
+	std::vector<JointChannels> channelMap;
+
+	// hash of the joint names, parents and channel layouts
+	uint64_t topologyHash;
+
+	// the role of each joint, and the first joint with each role (-1 if there is none)
+	// resolved once at load, so nothing at runtime needs to look at a name
+	std::vector<JointRole> jointRoles;
+	int roleJoints[JOINT_ROLE_COUNT];
+
+	// recursive descent parser for the hierarchy, appending joints under the given parent
+	bool ReadHierarchy(BVHTokenizer&, std::vector<std::string_view>&, int parent);
+
+	// append a joint (its parent must already be there), returning its index
+	int AddJoint(std::string_view name, int parent, const Cartesian3& offset);
+
+	// once all the joints are in, set up everything that is derived from them,
+	// resolving the joints' roles through the given retarget map
+	void Finish(const RoleMap& roles = DEFAULT_ROLE_MAP);
+
+	// work out the role of every joint from its name through a retarget map
+	// (Finish does this, so it is only needed before the rig is shared)
+	void ResolveRoles(const RoleMap& roles);
+
+	// the first joint with a role, or -1
+	int RoleJoint(JointRole role) const { return roleJoints[role]; }
+
+	// number of joints
+	int JointCount() const { return Bones.size(); }
+
+	// total number of channels over all joints
+	int CountChannels() const;
+
+	// forward kinematics: multiply each joint's local matrix onto its parent's global matrix
+	// both arrays hold JointCount() matrices, and the root's parent is the identity
+	void ComposePose(const Affine3* local, Affine3* global) const;
+
+	// same joints, parents and channels (everything the hash covers)
+	bool SameTopology(const Skeleton& other) const;
+
+	// and the same rest offsets and joint roles as well
+	bool SameRig(const Skeleton& other) const;
+
+	// the shared instance of the given rig: an identical one loaded earlier
+	// if there is one still in use, otherwise this one, which is remembered
+	static std::shared_ptr<const Skeleton> Share(const std::shared_ptr<Skeleton>& skeleton);
+	}; // class Skeleton
+
+typedef std::shared_ptr<const Skeleton> SkeletonHandle;
+
+#endif
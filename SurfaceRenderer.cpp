@@ -0,0 +1,86 @@
+#include "SurfaceRenderer.h"
+#include <vector>
+
+// the attributes, in the order of their indices
+static const char* const SURFACE_ATTRIBUTES[] = { "position", "normal" };
+static const int SURFACE_ATTRIBUTE_COUNT = sizeof(SURFACE_ATTRIBUTES) / sizeof(SURFACE_ATTRIBUTES[0]);
+
+// GLSL 1.20, so that it runs on legacy contexts, using their matrices and lighting
+static const char* SURFACE_VERTEX_SHADER =
+	"#version 120\n"
+	GLSL_FIXED_FUNCTION_LIGHTING
+	"uniform mat4 modelView;\n"
+	"attribute vec4 position;\n"
+	"attribute vec3 normal;\n"
+	"varying vec4 colour;\n"
+	"void main()\n"
+	"	{\n"
+	"	vec4 eyePosition = gl_ModelViewMatrix * (modelView * position);\n"
+	"	vec3 eyeNormal = normalize(gl_NormalMatrix * (mat3(modelView[0].xyz, modelView[1].xyz, modelView[2].xyz) * normal));\n"
+	"	colour = FixedFunctionLighting(eyePosition, eyeNormal);\n"
+	"	gl_Position = gl_ProjectionMatrix * eyePosition;\n"
+	"	}\n";
+
+// look up the entry points, build the shaders and upload the surface
+bool SurfaceRenderer::Initialise(GLProcLoader loader, const HomogeneousFaceSurface& surface)
+	{ // Initialise()
+	Release();
+	if (!gl.Load(loader))
+		return false;
+	program = BuildProgram(gl, SURFACE_VERTEX_SHADER, LIT_FRAGMENT_SHADER, SURFACE_ATTRIBUTES, SURFACE_ATTRIBUTE_COUNT);
+	if (program == 0)
+		return false;
+	modelViewLocation = gl.GetUniformLocation(program, "modelView");
+
+	// the normals are per triangle, so each goes with all three of its vertices
+	std::vector<Homogeneous4> vertices;
+	vertices.reserve(2 * surface.vertices.size());
+	for (size_t vertex = 0; vertex < surface.vertices.size(); vertex++)
+		{ // per vertex
+		vertices.push_back(surface.vertices[vertex]);
+		vertices.push_back(surface.normals[vertex / 3]);
+		} // per vertex
+	surfaceVertices = surface.vertices.size();
+
+	gl.GenBuffers(1, &surfaceBuffer);
+	gl.BindBuffer(GL_ARRAY_BUFFER, surfaceBuffer);
+	gl.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Homogeneous4), vertices.data(), GL_STATIC_DRAW);
+	gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+	} // Initialise()
+
+// delete the buffers and the program
+void SurfaceRenderer::Release()
+	{ // Release()
+	if (surfaceBuffer != 0)
+		gl.DeleteBuffers(1, &surfaceBuffer);
+	if (program != 0)
+		gl.DeleteProgram(program);
+	surfaceBuffer = program = 0;
+	surfaceVertices = 0;
+	modelViewLocation = -1;
+	} // Release()
+
+// draw the surface with the given model-view matrix
+void SurfaceRenderer::Draw(const Matrix4& viewMatrix)
+	{ // Draw()
+	if (!Ready() || surfaceVertices == 0)
+		return;
+	gl.UseProgram(program);
+	columnMajorMatrix columns = viewMatrix.columnMajor();
+	gl.UniformMatrix4fv(modelViewLocation, 1, GL_FALSE, columns.coordinates);
+
+	gl.BindBuffer(GL_ARRAY_BUFFER, surfaceBuffer);
+	gl.EnableVertexAttribArray(0);
+	gl.VertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(Homogeneous4), (const void*) 0);
+	gl.EnableVertexAttribArray(1);
+	gl.VertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(Homogeneous4), (const void*) sizeof(Homogeneous4));
+
+	glDrawArrays(GL_TRIANGLES, 0, surfaceVertices);
+
+	// and leave things as the immediate-mode drawing expects them
+	gl.DisableVertexAttribArray(1);
+	gl.DisableVertexAttribArray(0);
+	gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+	gl.UseProgram(0);
+	} // Draw()
@@ -0,0 +1,38 @@
+#ifndef _SURFACE_RENDERER_H
+#define _SURFACE_RENDERER_H
+
+#include "GLFunctions.h"
+#include "HomogeneousFaceSurface.h"
+#include "Matrix4.h"
+
+// retained-mode triangle soup: a surface's vertices and normals are uploaded to static
+// buffers once, and each frame only its model-view matrix goes to the shader, so the cost
+// on the CPU is the same however many triangles there are
+// the shader lights them as the fixed-function pipeline would, in the current material
+class SurfaceRenderer
+	{ // class SurfaceRenderer
+	public:
+	// look up the entry points, build the shaders and upload the surface, with the context current
+	// the surface can change afterwards without affecting what is drawn, until the next Initialise
+	// returns false, leaving the renderer unready, if the context cannot run the shaders
+	bool Initialise(GLProcLoader loader, const HomogeneousFaceSurface& surface);
+
+	// delete the buffers and the program, with the context current
+	void Release();
+
+	// whether Draw will draw anything
+	bool Ready() const { return program != 0; }
+
+	// draw the surface with the given model-view matrix, as HomogeneousFaceSurface::Render would
+	void Draw(const Matrix4& viewMatrix);
+
+	private:
+	GLFunctions gl;
+	GLuint program = 0;
+	GLint modelViewLocation = -1;
+	// each vertex of the triangles, followed by the normal of its triangle (w = 0)
+	GLuint surfaceBuffer = 0;
+	GLsizei surfaceVertices = 0;
+	}; // class SurfaceRenderer
+
+#endif
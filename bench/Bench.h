@@ -0,0 +1,80 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include "Quaternion.h"
+#include "BVHData.h"
+
+// shared helpers for the programs in bench/: each one checks its results against a
+// reference first, then times the code, and exits non-zero if any check failed
+
+// how many checks have failed so far
+static int benchFailures = 0;
+
+// report one check, counting it if it failed
+inline void Check(bool passed, const char* what)
+	{ // Check()
+	std::printf("%s: %s\n", passed ? "ok  " : "FAIL", what);
+	if (!passed)
+		benchFailures++;
+	} // Check()
+
+// the mean time in nanoseconds of one call of the job, over the given number of calls
+template <typename Job> double NanosecondsPerCall(long calls, Job job)
+	{ // NanosecondsPerCall()
+	// one untimed call, to warm the caches
+	job();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (long call = 0; call < calls; call++)
+		job();
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / calls;
+	} // NanosecondsPerCall()
+
+// results are summed into this so that the compiler cannot drop the timed work
+static volatile float benchSink = 0.0f;
+
+// a rotation in double precision, for the references results are measured against
+struct ReferenceRotation
+	{ // struct ReferenceRotation
+	double w, x, y, z;
+	}; // struct ReferenceRotation
+
+inline ReferenceRotation ToReference(const Quaternion& q)
+	{ // ToReference()
+	return ReferenceRotation{ q.w, q.x, q.y, q.z };
+	} // ToReference()
+
+// the angle in radians between two rotations, taken from the rotation from one to the
+// other, which stays accurate near zero (unlike the acos of their dot product)
+inline double AngleBetween(const ReferenceRotation& a, const ReferenceRotation& b)
+	{ // AngleBetween()
+	double w = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+	double x = a.w * b.x - a.x * b.w - a.y * b.z + a.z * b.y;
+	double y = a.w * b.y - a.y * b.w - a.z * b.x + a.x * b.z;
+	double z = a.w * b.z - a.z * b.w - a.x * b.y + a.y * b.x;
+	return 2.0 * std::atan2(std::sqrt(x * x + y * y + z * z), std::fabs(w));
+	} // AngleBetween()
+
+inline double AngleBetween(const Quaternion& a, const Quaternion& b)
+	{ // AngleBetween()
+	return AngleBetween(ToReference(a), ToReference(b));
+	} // AngleBetween()
+
+// read a clip from its text, without writing a compiled cache next to it
+// (the benchmarks run from the top of the tree, where models/ is)
+inline std::shared_ptr<BVHData> ReadClip(const char* fileName)
+	{ // ReadClip()
+	std::shared_ptr<BVHData> clip = std::make_shared<BVHData>();
+	if (!clip->ReadFileBVH(fileName))
+		{ // failed
+		std::printf("cannot read %s: run the benchmarks from the top of the tree\n", fileName);
+		return std::shared_ptr<BVHData>();
+		} // failed
+	return clip;
+	} // ReadClip()
+
+#endif
@@ -0,0 +1,186 @@
+// the batched slerp/nlerp kernel against a double precision slerp: the error each
+// accuracy mode promises in PoseBlend.h, and what each costs per quaternion
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "PoseBlend.h"
+#include "Quaternion.h"
+#include "Bench.h"
+
+// the true slerp the shorter way round, in double precision
+static ReferenceRotation ReferenceSlerp(ReferenceRotation a, ReferenceRotation b, double t)
+	{ // ReferenceSlerp()
+	double dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+	if (dot < 0.0)
+		{ // other hemisphere
+		b = ReferenceRotation{ -b.w, -b.x, -b.y, -b.z };
+		dot = -dot;
+		} // other hemisphere
+	double angle = std::acos(std::min(1.0, dot));
+	double from = 1.0 - t, to = t;
+	if (std::sin(angle) > 1e-12)
+		{ // far enough apart
+		from = std::sin((1.0 - t) * angle) / std::sin(angle);
+		to = std::sin(t * angle) / std::sin(angle);
+		} // far enough apart
+	ReferenceRotation result{ from * a.w + to * b.w, from * a.x + to * b.x, from * a.y + to * b.y, from * a.z + to * b.z };
+	double length = std::sqrt(result.w * result.w + result.x * result.x + result.y * result.y + result.z * result.z);
+	return ReferenceRotation{ result.w / length, result.x / length, result.y / length, result.z / length };
+	} // ReferenceSlerp()
+
+// a run of quaternions as four component arrays, as the tracks keep them
+struct QuaternionRows
+	{ // struct QuaternionRows
+	std::vector<float> data;
+	int count;
+	explicit QuaternionRows(int count) : data(4 * count), count(count) {}
+	float* Row(int component) { return data.data() + component * count; }
+	Quaternion At(int index) const { return Quaternion(data[index], data[count + index], data[2 * count + index], data[3 * count + index]); }
+	}; // struct QuaternionRows
+
+int main()
+	{ // main()
+	const int COUNT = 65536;
+	std::mt19937 random(14);
+	std::normal_distribution<float> gaussian;
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// random rotations (normalized gaussians are uniform over the sphere), with a
+	// share of close pairs so the small angle paths are covered too, and random weights
+	QuaternionRows from(COUNT), to(COUNT), result(COUNT);
+	std::vector<float> weights(COUNT);
+	for (int index = 0; index < COUNT; index++)
+		{ // per pair
+		Quaternion a(gaussian(random), gaussian(random), gaussian(random), gaussian(random));
+		Quaternion b(gaussian(random), gaussian(random), gaussian(random), gaussian(random));
+		a.Normalize();
+		if (index % 4 == 0)
+			b = a + 0.01f * unit(random) * b;
+		b.Normalize();
+		const float aComponents[4] = { a.w, a.x, a.y, a.z };
+		const float bComponents[4] = { b.w, b.x, b.y, b.z };
+		for (int component = 0; component < 4; component++)
+			{ // per component
+			from.Row(component)[index] = aComponents[component];
+			to.Row(component)[index] = bComponents[component];
+			} // per component
+		weights[index] = unit(random);
+		} // per pair
+	const float* fromRows[4] = { from.Row(0), from.Row(1), from.Row(2), from.Row(3) };
+	const float* toRows[4] = { to.Row(0), to.Row(1), to.Row(2), to.Row(3) };
+	float* resultRows[4] = { result.Row(0), result.Row(1), result.Row(2), result.Row(3) };
+
+	// the largest angle of any result from the reference
+	auto maxError = [&]()
+		{ // maxError()
+		double error = 0.0;
+		for (int index = 0; index < COUNT; index++)
+			{ // per pair
+			ReferenceRotation expected = ReferenceSlerp(ToReference(from.At(index)), ToReference(to.At(index)), weights[index]);
+			error = std::max(error, AngleBetween(ToReference(result.At(index)), expected));
+			} // per pair
+		return error;
+		}; // maxError()
+	char line[128];
+
+	// the bounds documented with BlendAccuracy
+	BlendQuaternions(fromRows, toRows, weights.data(), resultRows, COUNT, BLEND_EXACT);
+	double exactError = maxError();
+	std::snprintf(line, sizeof(line), "BLEND_EXACT is within 3e-7 rad of a double slerp (max %.2g rad)", exactError);
+	Check(exactError <= 3e-7, line);
+	BlendQuaternions(fromRows, toRows, weights.data(), resultRows, COUNT, BLEND_FAST);
+	double fastError = maxError();
+	std::snprintf(line, sizeof(line), "BLEND_FAST is within 8e-4 rad of a double slerp (max %.2g rad)", fastError);
+	Check(fastError <= 8e-4, line);
+	double slerpError = 0.0;
+	for (int index = 0; index < COUNT; index++)
+		slerpError = std::max(slerpError, AngleBetween(ToReference(Slerp(from.At(index), to.At(index), weights[index])),
+			ReferenceSlerp(ToReference(from.At(index)), ToReference(to.At(index)), weights[index])));
+	std::printf("Slerp() for comparison: max %.2g rad\n", slerpError);
+
+	// one weight for the whole run gives the same as that weight everywhere, in place too
+	std::vector<float> half(COUNT, 0.5f);
+	QuaternionRows perWeight(COUNT);
+	float* perWeightRows[4] = { perWeight.Row(0), perWeight.Row(1), perWeight.Row(2), perWeight.Row(3) };
+	BlendQuaternions(fromRows, toRows, half.data(), perWeightRows, COUNT, BLEND_EXACT);
+	result.data = from.data;
+	BlendQuaternions(resultRows, toRows, 0.5f, resultRows, COUNT, BLEND_EXACT);
+	Check(result.data == perWeight.data, "one weight matches a weight per quaternion, and blends in place");
+
+	// any number of inputs: two give the pairwise blend, and a third input with next to no
+	// weight moves nothing by more than next to nothing, whatever the accuracy
+	QuaternionRows third(COUNT), many(COUNT);
+	for (int index = 0; index < COUNT; index++)
+		{ // per quaternion
+		Quaternion c(gaussian(random), gaussian(random), gaussian(random), gaussian(random));
+		c.Normalize();
+		const float cComponents[4] = { c.w, c.x, c.y, c.z };
+		for (int component = 0; component < 4; component++)
+			third.Row(component)[index] = cComponents[component];
+		} // per quaternion
+	const float* inputs[12] = { from.Row(0), from.Row(1), from.Row(2), from.Row(3), to.Row(0), to.Row(1), to.Row(2), to.Row(3),
+		third.Row(0), third.Row(1), third.Row(2), third.Row(3) };
+	float* manyRows[4] = { many.Row(0), many.Row(1), many.Row(2), many.Row(3) };
+	const float TINY = 1e-6f;
+	for (BlendAccuracy accuracy : { BLEND_EXACT, BLEND_FAST })
+		{ // per accuracy
+		const char* name = (accuracy == BLEND_EXACT) ? "BLEND_EXACT" : "BLEND_FAST";
+		const float pairWeights[3] = { 0.75f, 0.25f, TINY };
+		BlendQuaternions(fromRows, toRows, 0.25f, resultRows, COUNT, accuracy);
+		BlendManyQuaternions(inputs, pairWeights, 2, manyRows, COUNT, accuracy);
+		std::snprintf(line, sizeof(line), "%s: two inputs to BlendManyQuaternions match BlendQuaternions bit for bit", name);
+		Check(many.data == result.data, line);
+		BlendManyQuaternions(inputs, pairWeights, 3, manyRows, COUNT, accuracy);
+		double jump = 0.0;
+		for (int index = 0; index < COUNT; index++)
+			jump = std::max(jump, AngleBetween(many.At(index), result.At(index)));
+		std::snprintf(line, sizeof(line), "%s: a third input weighted %g moves the blend by at most %.2g rad", name, TINY, jump);
+		Check(jump <= 1e-5, line);
+		} // per accuracy
+
+	// the case that used to jump: a quarter of the way through 90 degrees, with and without a third input
+	Quaternion quarterTurn(90.0f, Cartesian3(1.0f, 0.0f, 0.0f));
+	Quaternion start(1.0f, 0.0f, 0.0f, 0.0f);
+	float quarterComponents[3][4] = { { start.w, start.x, start.y, start.z }, { quarterTurn.w, quarterTurn.x, quarterTurn.y, quarterTurn.z },
+		{ quarterTurn.w, quarterTurn.x, quarterTurn.y, quarterTurn.z } };
+	float quarterResult[4];
+	float* quarterRows[4] = { quarterResult, quarterResult + 1, quarterResult + 2, quarterResult + 3 };
+	const float* quarterInputs[12];
+	for (int input = 0; input < 3; input++)
+		for (int component = 0; component < 4; component++)
+			quarterInputs[4 * input + component] = &quarterComponents[input][component];
+	const float quarterWeights[3] = { 0.75f, 0.25f, TINY };
+	double angles[2];
+	for (int inputCount = 2; inputCount <= 3; inputCount++)
+		{ // two inputs, then three
+		BlendManyQuaternions(quarterInputs, quarterWeights, inputCount, quarterRows, 1, BLEND_EXACT);
+		angles[inputCount - 2] = AngleBetween(Quaternion(quarterResult[0], quarterResult[1], quarterResult[2], quarterResult[3]), start);
+		} // two inputs, then three
+	std::snprintf(line, sizeof(line), "a quarter of 90 degrees is %.4g degrees with two inputs and %.4g with a third",
+		angles[0] * 180.0 / M_PI, angles[1] * 180.0 / M_PI);
+	Check(std::fabs(angles[0] - M_PI / 8.0) < 1e-6 && std::fabs(angles[1] - angles[0]) < 1e-5, line);
+
+	// the cost of each, per quaternion
+	const long CALLS = 100;
+	double exactTime = NanosecondsPerCall(CALLS, [&]()
+		{ // exact
+		BlendQuaternions(fromRows, toRows, weights.data(), resultRows, COUNT, BLEND_EXACT);
+		}) / COUNT;
+	double fastTime = NanosecondsPerCall(CALLS, [&]()
+		{ // fast
+		BlendQuaternions(fromRows, toRows, weights.data(), resultRows, COUNT, BLEND_FAST);
+		}) / COUNT;
+	double slerpTime = NanosecondsPerCall(CALLS, [&]()
+		{ // one at a time
+		for (int index = 0; index < COUNT; index++)
+			benchSink = benchSink + Slerp(from.At(index), to.At(index), weights[index]).w;
+		}) / COUNT;
+	const float threeWeights[3] = { 0.5f, 0.3f, 0.2f };
+	double threeTime = NanosecondsPerCall(CALLS, [&]()
+		{ // three inputs
+		BlendManyQuaternions(inputs, threeWeights, 3, manyRows, COUNT, BLEND_EXACT);
+		}) / COUNT;
+	std::printf("per quaternion: BLEND_EXACT %.2f ns, BLEND_FAST %.2f ns, Slerp() %.2f ns, three inputs BLEND_EXACT %.2f ns\n",
+		exactTime, fastTime, slerpTime, threeTime);
+	return benchFailures ? 1 : 0;
+	} // main()
@@ -0,0 +1,153 @@
+#ifndef _HEADLESS_GL_H
+#define _HEADLESS_GL_H
+
+#include <algorithm>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// a GL context with no window, for drawing the renderers against the immediate-mode
+// paths they replaced: Mesa's surfaceless EGL platform, which is llvmpipe without a GPU
+// (so the times are CPU rasterisation, and say more about submission than about drawing)
+class HeadlessGL
+	{ // class HeadlessGL
+	public:
+	// make a context with a colour and depth buffer of the given size current,
+	// saying why and returning false if there is no surfaceless display to be had
+	bool Open(int width, int height)
+		{ // Open()
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getDisplay == nullptr)
+			return Fail("no eglGetPlatformDisplayEXT");
+		display = getDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+			return Fail("no surfaceless EGL display");
+
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_NONE };
+		EGLConfig config;
+		EGLint configs = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs == 0)
+			return Fail("no pbuffer config with depth");
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+		surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+		// a compatibility context, since the old paths are fixed-function
+		if (surface == EGL_NO_SURFACE || !eglBindAPI(EGL_OPENGL_API))
+			return Fail("no desktop GL pbuffer");
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+			return Fail("no desktop GL context");
+
+		this->width = width;
+		this->height = height;
+		std::printf("headless GL: %s, %s\n", (const char*) glGetString(GL_RENDERER), (const char*) glGetString(GL_VERSION));
+		return true;
+		} // Open()
+
+	~HeadlessGL()
+		{ // ~HeadlessGL()
+		if (display == EGL_NO_DISPLAY)
+			return;
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (context != EGL_NO_CONTEXT)
+			eglDestroyContext(display, context);
+		if (surface != EGL_NO_SURFACE)
+			eglDestroySurface(display, surface);
+		eglTerminate(display);
+		} // ~HeadlessGL()
+
+	// the loader the renderers look their entry points up with
+	static void* ProcAddress(const char* name)
+		{ // ProcAddress()
+		return (void*) eglGetProcAddress(name);
+		} // ProcAddress()
+
+	// set up a frame as SceneModel does: the projection of AnimationCycleWidget, one distant
+	// light and flat shading in the given material, on the mid-grey background
+	void BeginFrame(const GLfloat material[4])
+		{ // BeginFrame()
+		const GLfloat ambient[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
+		const GLfloat diffuse[4] = { 0.7f, 0.7f, 0.7f, 1.0f };
+		const GLfloat black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		const GLfloat light[4] = { 0.5f, 0.6f, 0.62f, 0.0f };
+		glViewport(0, 0, width, height);
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		gluPerspective(90.0, (double) width / height, 0.1, 100000);
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+
+		glEnable(GL_DEPTH_TEST);
+		glShadeModel(GL_FLAT);
+		glEnable(GL_LIGHT0);
+		glEnable(GL_LIGHTING);
+		glLightfv(GL_LIGHT0, GL_AMBIENT, ambient);
+		glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse);
+		glLightfv(GL_LIGHT0, GL_SPECULAR, black);
+		glLightfv(GL_LIGHT0, GL_POSITION, light);
+		glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, material);
+		glMaterialfv(GL_FRONT, GL_SPECULAR, black);
+		glMaterialfv(GL_FRONT, GL_EMISSION, black);
+		} // BeginFrame()
+
+	// the colour buffer, as RGBA bytes from the bottom row up
+	std::vector<unsigned char> ReadPixels() const
+		{ // ReadPixels()
+		std::vector<unsigned char> pixels(4 * width * height);
+		glFinish();
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		return pixels;
+		} // ReadPixels()
+
+	private:
+	bool Fail(const char* why)
+		{ // Fail()
+		std::printf("headless GL: %s\n", why);
+		return false;
+		} // Fail()
+
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLSurface surface = EGL_NO_SURFACE;
+	EGLContext context = EGL_NO_CONTEXT;
+	int width = 0, height = 0;
+	}; // class HeadlessGL
+
+// how two frames differ: of the pixels the reference drew on (those not the background),
+// how many come out differently, and by at most how much in any channel
+struct ImageDifference
+	{ // struct ImageDifference
+	long covered = 0;
+	long differing = 0;
+	int largest = 0;
+	}; // struct ImageDifference
+
+inline ImageDifference CompareImages(const std::vector<unsigned char>& reference, const std::vector<unsigned char>& image)
+	{ // CompareImages()
+	ImageDifference difference;
+	for (size_t pixel = 0; pixel + 3 < reference.size(); pixel += 4)
+		{ // per pixel
+		int background = 0, largest = 0;
+		for (int channel = 0; channel < 3; channel++)
+			{ // per channel
+			background = std::max(background, std::abs(reference[pixel + channel] - 128));
+			largest = std::max(largest, std::abs(reference[pixel + channel] - image[pixel + channel]));
+			} // per channel
+		if (background > 1)
+			difference.covered++;
+		if (largest > 0)
+			difference.differing++;
+		difference.largest = std::max(difference.largest, largest);
+		} // per pixel
+	return difference;
+	} // CompareImages()
+
+#endif
@@ -0,0 +1,111 @@
+// pose layers over a blended pose: masked joints take the layer, the rest are never touched,
+// and the cost follows the size of the mask rather than of the skeleton
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "BlendTree.h"
+#include "Bench.h"
+
+int main()
+	{ // main()
+	ClipHandle run = ReadClip("models/fast_run.bvh");
+	ClipHandle veer = ReadClip("models/veer_left.bvh");
+	if (!run || !veer)
+		return 1;
+	const Skeleton& rig = *run->skeleton;
+	int jointCount = rig.JointCount();
+
+	// the upper body, one arm, and everything
+	JointMask upperBody, leftArm, everything;
+	upperBody.AddSubtree(rig, rig.RoleJoint(ROLE_SPINE));
+	leftArm.AddSubtree(rig, rig.RoleJoint(ROLE_LEFT_ARM));
+	everything.AddSubtree(rig, 0);
+
+	// the run on its own, as the pose underneath every layer
+	PoseBlender blender;
+	std::vector<BlendInput> inputs{ BlendInput{ run.get(), 3, 1.0f } };
+	blender.Evaluate(inputs);
+	std::vector<Quaternion> underneath(jointCount);
+	for (int joint = 0; joint < jointCount; joint++)
+		underneath[joint] = blender.Rotation(joint);
+
+	// compares the result with the pose underneath outside the mask, and with the expected
+	// rotation inside it
+	auto compare = [&](const JointMask& mask, auto expected, double& error)
+		{ // compare()
+		bool untouched = true;
+		error = 0.0;
+		for (int joint = 0; joint < jointCount; joint++)
+			{ // per joint
+			Quaternion rotation = blender.Rotation(joint);
+			if (mask.Contains(joint))
+				error = std::max(error, AngleBetween(rotation, expected(joint)));
+			else
+				untouched = untouched && std::memcmp(&rotation, &underneath[joint], sizeof(Quaternion)) == 0;
+			} // per joint
+		return untouched;
+		}; // compare()
+	double error;
+	char line[128];
+
+	// a full override puts the layer's own rotation on every masked joint
+	PoseLayer overrideLayer{ LAYER_OVERRIDE, veer.get(), 5, 1.0f, &upperBody, nullptr, 0 };
+	blender.ApplyLayer(overrideLayer);
+	bool untouched = compare(upperBody, [&](int joint) { return veer->tracks.Orientation(5, joint); }, error);
+	Check(untouched, "override: joints outside the mask are bit-identical");
+	std::snprintf(line, sizeof(line), "override: masked joints take the layer (max %.2g rad)", error);
+	Check(error < 1e-5, line);
+
+	// half an override goes half way
+	blender.Evaluate(inputs);
+	overrideLayer.weight = 0.5f;
+	blender.ApplyLayer(overrideLayer);
+	untouched = compare(upperBody, [&](int joint)
+		{ // half way
+		return Slerp(underneath[joint], veer->tracks.Orientation(5, joint), 0.5f);
+		}, error);
+	Check(untouched, "half override: joints outside the mask are bit-identical");
+	std::snprintf(line, sizeof(line), "half override: masked joints are half way to the layer (max %.2g rad)", error);
+	Check(error < 1e-4, line);
+
+	// an additive layer at its own reference pose adds nothing
+	blender.Evaluate(inputs);
+	PoseLayer additive{ LAYER_ADDITIVE, veer.get(), 5, 1.0f, &leftArm, veer.get(), 5 };
+	blender.ApplyLayer(additive);
+	untouched = compare(leftArm, [&](int joint) { return underneath[joint]; }, error);
+	Check(untouched, "additive: joints outside the mask are bit-identical");
+	std::snprintf(line, sizeof(line), "additive: a layer at its reference adds nothing (max %.2g rad)", error);
+	Check(error < 1e-5, line);
+
+	// a layer is refused, changing nothing, with no pose under it or a mask past its joints
+	PoseBlender unevaluated;
+	Check(!unevaluated.ApplyLayer(additive), "a layer before any Evaluate is refused");
+	std::vector<BlendInput> weightless{ BlendInput{ run.get(), 3, 0.0f } };
+	unevaluated.Evaluate(weightless);
+	Check(!unevaluated.ApplyLayer(additive), "a layer over an Evaluate that had nothing to blend is refused");
+	JointMask beyond = leftArm;
+	beyond.Add(jointCount);
+	blender.Evaluate(inputs);
+	overrideLayer.mask = &beyond;
+	bool refused = !blender.ApplyLayer(overrideLayer);
+	untouched = compare(JointMask(), [&](int joint) { return underneath[joint]; }, error);
+	Check(refused && untouched, "a mask reaching past the skeleton is refused, changing nothing");
+
+	// cost, for masks of different sizes
+	const long CALLS = 200000;
+	for (const JointMask* mask : { &leftArm, &upperBody, &everything })
+		for (LayerMode mode : { LAYER_OVERRIDE, LAYER_ADDITIVE })
+			{ // per mask and mode
+			PoseLayer layer{ mode, veer.get(), 0, 0.7f, mask, veer.get(), 0 };
+			long call = 0;
+			double nanoseconds = NanosecondsPerCall(CALLS, [&]()
+				{ // apply layer
+				layer.frame = call++ % veer->frame_count;
+				blender.ApplyLayer(layer);
+				});
+			benchSink = benchSink + blender.Rotation(0).w;
+			std::printf("%s, %2d of %d joints: %7.1f ns, %5.1f ns per joint\n", mode == LAYER_OVERRIDE ? "override" : "additive",
+				mask->JointCount(), jointCount, nanoseconds, nanoseconds / mask->JointCount());
+			} // per mask and mode
+	return benchFailures ? 1 : 0;
+	} // main()
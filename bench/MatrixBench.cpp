@@ -0,0 +1,145 @@
+// Matrix4 products against the original scalar loops
+// the SIMD kernels add the same products in the same order, so they must agree bit for bit
+// and the Affine3 conversions and inverse, round trip
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Affine3.h"
+#include "Matrix4.h"
+#include "Bench.h"
+
+// the original scalar matrix product
+// (one statement per product, so the compiler cannot fuse them into FMAs)
+static Matrix4 ScalarProduct(const Matrix4& a, const Matrix4& b)
+	{ // ScalarProduct()
+	Matrix4 product;
+	for (int row = 0; row < 4; row++)
+		for (int col = 0; col < 4; col++)
+			for (int entry = 0; entry < 4; entry++)
+				{ // per term
+				float term = a.coordinates[row][entry] * b.coordinates[entry][col];
+				product.coordinates[row][col] += term;
+				} // per term
+	return product;
+	} // ScalarProduct()
+
+// the original scalar matrix-vector product
+static Homogeneous4 ScalarTransform(const Matrix4& a, const Homogeneous4& vector)
+	{ // ScalarTransform()
+	Homogeneous4 product(0.0f, 0.0f, 0.0f, 0.0f);
+	for (int row = 0; row < 4; row++)
+		for (int col = 0; col < 4; col++)
+			{ // per term
+			float term = a.coordinates[row][col] * vector[col];
+			product[row] += term;
+			} // per term
+	return product;
+	} // ScalarTransform()
+
+// exact comparison
+template <typename T> static bool Same(const T& a, const T& b)
+	{ // Same()
+	return std::memcmp(&a, &b, sizeof(T)) == 0;
+	} // Same()
+
+int main()
+	{ // main()
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+	const int COUNT = 4096;
+
+	// random matrices and vectors
+	std::vector<Matrix4> matrices(COUNT);
+	std::vector<Homogeneous4> vectors(COUNT);
+	for (int i = 0; i < COUNT; i++)
+		{ // per sample
+		for (int row = 0; row < 4; row++)
+			for (int col = 0; col < 4; col++)
+				matrices[i].coordinates[row][col] = value(random);
+		vectors[i] = Homogeneous4(value(random), value(random), value(random), value(random));
+		} // per sample
+
+	// equivalence
+	bool products = true, transforms = true, points = true;
+	for (int i = 0; i < COUNT; i++)
+		{ // per sample
+		const Matrix4& a = matrices[i];
+		const Matrix4& b = matrices[(i + 1) % COUNT];
+		products = products && Same(a * b, ScalarProduct(a, b));
+		transforms = transforms && Same(a * vectors[i], ScalarTransform(a, vectors[i]));
+		Cartesian3 point(vectors[i].x, vectors[i].y, vectors[i].z);
+		points = points && Same(a * point, ScalarTransform(a, Homogeneous4(point)).Point());
+		} // per sample
+	Check(products, "Matrix4 * Matrix4 matches the scalar loops bit for bit");
+	Check(transforms, "Matrix4 * Homogeneous4 matches the scalar loops bit for bit");
+	Check(points, "Matrix4 * Cartesian3 matches the scalar loops bit for bit");
+
+	// the batch transform, both into another array and in place
+	std::vector<Homogeneous4> batch(COUNT), inPlace(vectors);
+	matrices[0].Transform(vectors.data(), batch.data(), COUNT);
+	matrices[0].Transform(inPlace.data(), inPlace.data(), COUNT);
+	bool batched = true;
+	for (int i = 0; i < COUNT; i++)
+		batched = batched && Same(batch[i], matrices[0] * vectors[i]) && Same(inPlace[i], batch[i]);
+	Check(batched, "Matrix4::Transform matches one Matrix4 * Homogeneous4 per point, in place too");
+
+	// rigid transforms, through Matrix4 and back, through a quaternion and back, and inverted
+	std::normal_distribution<float> gaussian;
+	bool throughMatrix = true;
+	double quaternionError = 0.0, inverseError = 0.0;
+	for (int i = 0; i < COUNT; i++)
+		{ // per sample
+		Quaternion rotation(gaussian(random), gaussian(random), gaussian(random), gaussian(random));
+		rotation.Normalize();
+		Cartesian3 translation(value(random), value(random), value(random));
+		Affine3 rigid = Affine3::Rigid(rotation, translation);
+		throughMatrix = throughMatrix && Affine3(rigid.ToMatrix4()) == rigid;
+		quaternionError = std::max(quaternionError, AngleBetween(rigid.ToQuaternion(), rotation));
+		// both ways round give the identity, to within float rounding of translations up to 17 long
+		Affine3 identity;
+		for (const Affine3& product : { rigid.Inverse() * rigid, rigid * rigid.Inverse() })
+			for (int row = 0; row < 3; row++)
+				for (int col = 0; col < 4; col++)
+					inverseError = std::max(inverseError, (double) std::fabs(product[row][col] - identity[row][col]));
+		} // per sample
+	Check(throughMatrix, "Affine3 to Matrix4 and back is exact");
+	char line[128];
+	std::snprintf(line, sizeof(line), "Affine3::ToQuaternion gives back the rotation (max %.2g rad)", quaternionError);
+	Check(quaternionError <= 2e-6, line);
+	std::snprintf(line, sizeof(line), "Affine3::Inverse undoes the transform both ways round (max %.2g from the identity)", inverseError);
+	Check(inverseError <= 2e-5, line);
+
+	// timings
+	long calls = 200;
+	double scalarProduct = NanosecondsPerCall(calls, [&]()
+		{ // scalar products
+		for (int i = 0; i < COUNT; i++)
+			benchSink = benchSink + ScalarProduct(matrices[i], matrices[COUNT - 1 - i]).coordinates[0][0];
+		}) / COUNT;
+	double simdProduct = NanosecondsPerCall(calls, [&]()
+		{ // kernel products
+		for (int i = 0; i < COUNT; i++)
+			benchSink = benchSink + (matrices[i] * matrices[COUNT - 1 - i]).coordinates[0][0];
+		}) / COUNT;
+	double scalarTransform = NanosecondsPerCall(calls, [&]()
+		{ // scalar transforms
+		for (int i = 0; i < COUNT; i++)
+			benchSink = benchSink + ScalarTransform(matrices[0], vectors[i]).x;
+		}) / COUNT;
+	double simdTransform = NanosecondsPerCall(calls, [&]()
+		{ // kernel transforms
+		for (int i = 0; i < COUNT; i++)
+			benchSink = benchSink + (matrices[0] * vectors[i]).x;
+		}) / COUNT;
+	double batchTransform = NanosecondsPerCall(calls, [&]()
+		{ // batch transform
+		matrices[0].Transform(vectors.data(), batch.data(), COUNT);
+		benchSink = benchSink + batch[COUNT - 1].x;
+		}) / COUNT;
+
+	std::printf("Matrix4 * Matrix4:      scalar %6.2f ns, kernel %6.2f ns\n", scalarProduct, simdProduct);
+	std::printf("Matrix4 * Homogeneous4: scalar %6.2f ns, kernel %6.2f ns, batched %6.2f ns per point\n",
+		scalarTransform, simdTransform, batchTransform);
+	return benchFailures ? 1 : 0;
+	} // main()
@@ -0,0 +1,192 @@
+// forward kinematics and bone geometry without GL: EvaluatePose against a double precision
+// walk up the hierarchy, EvaluatePoseAtTime and the composer Render poses the rig with
+// against it, and the batched bone vertices against one transform per vertex
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Affine3.h"
+#include "BoneMesh.h"
+#include "BoneRenderer.h"
+#include "PoseComposer.h"
+#include "Bench.h"
+
+// a rotation and translation in double precision, the same layout as Affine3
+struct ReferenceTransform
+	{ // struct ReferenceTransform
+	double coordinates[3][4];
+	}; // struct ReferenceTransform
+
+// the rotation matrix Quaternion::ToRotationAffine builds, in double precision
+static ReferenceTransform ReferenceRotationMatrix(const Quaternion& q)
+	{ // ReferenceRotationMatrix()
+	double w = q.w, x = q.x, y = q.y, z = q.z;
+	ReferenceTransform result = { {
+		{ 1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + w * z), 2.0 * (x * z - w * y), 0.0 },
+		{ 2.0 * (x * y - w * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + w * x), 0.0 },
+		{ 2.0 * (x * z + w * y), 2.0 * (y * z - w * x), 1.0 - 2.0 * (x * x + y * y), 0.0 } } };
+	return result;
+	} // ReferenceRotationMatrix()
+
+// the global transform of a joint, composed by recursing up to the root
+static ReferenceTransform ReferenceGlobal(const BVHData& clip, int frame, float scale, int joint)
+	{ // ReferenceGlobal()
+	const Skeleton& rig = *clip.skeleton;
+	ReferenceTransform local = ReferenceRotationMatrix(clip.tracks.Orientation(frame, joint));
+	local.coordinates[0][3] = (double) rig.boneTranslations[joint].x * scale;
+	local.coordinates[1][3] = (double) rig.boneTranslations[joint].y * scale;
+	local.coordinates[2][3] = (double) rig.boneTranslations[joint].z * scale;
+	int parent = rig.parentBones[joint];
+	if (parent < 0)
+		return local;
+	ReferenceTransform above = ReferenceGlobal(clip, frame, scale, parent);
+	ReferenceTransform global;
+	for (int row = 0; row < 3; row++)
+		for (int col = 0; col < 4; col++)
+			{ // per entry
+			global.coordinates[row][col] = (col == 3) ? above.coordinates[row][3] : 0.0;
+			for (int entry = 0; entry < 3; entry++)
+				global.coordinates[row][col] += above.coordinates[row][entry] * local.coordinates[entry][col];
+			} // per entry
+	return global;
+	} // ReferenceGlobal()
+
+int main()
+	{ // main()
+	ClipHandle run = ReadClip("models/fast_run.bvh");
+	if (!run)
+		return 1;
+	const Skeleton& rig = *run->skeleton;
+	int jointCount = rig.JointCount();
+	int frameCount = run->frame_count;
+	const float SCALE = 0.01f;
+	char line[128];
+
+	// EvaluatePose against the reference: the rotations as they are, and the translations
+	// relative to the size of the pose
+	std::vector<Affine3> local(jointCount), global(jointCount);
+	double rotationError = 0.0, translationError = 0.0, poseSize = 0.0;
+	for (int frame = 0; frame < frameCount; frame++)
+		{ // per frame
+		run->EvaluatePose(frame, SCALE, local.data(), global.data());
+		for (int joint = 0; joint < jointCount; joint++)
+			{ // per joint
+			ReferenceTransform expected = ReferenceGlobal(*run, frame, SCALE, joint);
+			for (int row = 0; row < 3; row++)
+				{ // per row
+				for (int col = 0; col < 3; col++)
+					rotationError = std::max(rotationError, std::fabs(global[joint][row][col] - expected.coordinates[row][col]));
+				translationError = std::max(translationError, std::fabs(global[joint][row][3] - expected.coordinates[row][3]));
+				poseSize = std::max(poseSize, std::fabs(expected.coordinates[row][3]));
+				} // per row
+			} // per joint
+		} // per frame
+	translationError /= poseSize;
+	std::snprintf(line, sizeof(line), "EvaluatePose matches a double precision walk up the hierarchy"
+		" (max %.2g in rotation, %.2g of the pose in translation)", rotationError, translationError);
+	Check(rotationError <= 1e-5 && translationError <= 1e-5, line);
+
+	// at the time of a frame, EvaluatePoseAtTime is that frame; between frames, the composer
+	// Render poses the rig with gives the same globals as composing the whole pose
+	PoseBlender pose;
+	PoseComposer composer;
+	std::vector<Affine3> timedLocal(jointCount), timedGlobal(jointCount);
+	bool onFrames = true, sameComposed = true;
+	for (int frame = 0; frame < frameCount; frame++)
+		{ // per frame
+		run->EvaluatePose(frame, SCALE, local.data(), global.data());
+		onFrames = onFrames && run->EvaluatePoseAtTime(frame * (double) run->frame_time, SCALE, pose, timedLocal.data(), timedGlobal.data())
+			&& std::memcmp(global.data(), timedGlobal.data(), jointCount * sizeof(Affine3)) == 0;
+		run->EvaluatePoseAtTime((frame + 0.5) * run->frame_time, SCALE, pose, timedLocal.data(), timedGlobal.data());
+		run->EvaluatePose(pose, SCALE, composer);
+		sameComposed = sameComposed && std::memcmp(composer.Globals(), timedGlobal.data(), jointCount * sizeof(Affine3)) == 0;
+		} // per frame
+	Check(onFrames, "EvaluatePoseAtTime on a frame's time is EvaluatePose of that frame, bit for bit");
+	Check(sameComposed, "the composer Render poses the rig with gives the same globals as EvaluatePose");
+
+	const long POSES = 2000;
+	long call = 0;
+	double poseTime = NanosecondsPerCall(POSES, [&]()
+		{ // evaluate a pose
+		run->EvaluatePose(call++ % frameCount, SCALE, local.data(), global.data());
+		benchSink = benchSink + global[jointCount - 1][0][3];
+		});
+	double timedTime = NanosecondsPerCall(POSES, [&]()
+		{ // evaluate a pose between frames
+		run->EvaluatePoseAtTime((call++ + 0.5) * run->frame_time, SCALE, pose, local.data(), global.data());
+		benchSink = benchSink + global[jointCount - 1][0][3];
+		});
+	std::printf("EvaluatePose: %.2f us per %d joint pose, %.1f M joints/s; EvaluatePoseAtTime between frames %.2f us\n",
+		poseTime / 1000.0, jointCount, jointCount / poseTime * 1000.0, timedTime / 1000.0);
+
+	// bones with random orientations, lengths and places, as DrawPose hands them on
+	std::mt19937 random(23);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+	const int BONES = 64;
+	std::vector<Matrix4> transforms(BONES);
+	std::vector<float> radii(BONES), lengths(BONES);
+	for (int bone = 0; bone < BONES; bone++)
+		{ // per bone
+		Quaternion rotation(value(random), value(random), value(random), value(random));
+		rotation.Normalize();
+		Affine3 transform = rotation.ToRotationAffine();
+		transform.SetTranslation(Cartesian3(10.0f * value(random), 10.0f * value(random), 10.0f * value(random)));
+		transforms[bone] = transform.ToMatrix4();
+		radii[bone] = size(random);
+		lengths[bone] = size(random);
+		} // per bone
+
+	// every vertex and normal of the batch against its own transform of the unit cylinder
+	BoneBatch batch;
+	batch.Begin(BONE_SLICES);
+	for (int bone = 0; bone < BONES; bone++)
+		batch.AddCylinder(transforms[bone], radii[bone], lengths[bone]);
+	CylinderMesh mesh(BONE_SLICES);
+	size_t perBone = mesh.pointIndex.size();
+	bool counted = batch.Bones() == BONES && batch.VertexCount() == BONES * perBone;
+	double vertexError = 0.0, normalError = 0.0;
+	for (int bone = 0; counted && bone < BONES; bone++)
+		for (size_t vertex = 0; vertex < perBone; vertex++)
+			{ // per vertex
+			const Homogeneous4& unitPoint = mesh.points[mesh.pointIndex[vertex]];
+			const Homogeneous4& unitNormal = mesh.normals[mesh.normalIndex[vertex]];
+			Homogeneous4 point(unitPoint.x * radii[bone], unitPoint.y * radii[bone], unitPoint.z * lengths[bone], 1.0f);
+			Homogeneous4 expectedPoint = transforms[bone] * point;
+			Homogeneous4 expectedNormal = transforms[bone] * unitNormal;
+			const Homogeneous4& actualPoint = batch.Vertices()[bone * perBone + vertex];
+			const Homogeneous4& actualNormal = batch.Normals()[bone * perBone + vertex];
+			for (int component = 0; component < 4; component++)
+				{ // per component
+				vertexError = std::max(vertexError, (double) std::fabs(actualPoint[component] - expectedPoint[component]));
+				normalError = std::max(normalError, (double) std::fabs(actualNormal[component] - expectedNormal[component]));
+				} // per component
+			} // per vertex
+	Check(counted, "BoneBatch holds every vertex of every bone added");
+	// the bones reach about 13 units from the origin, so the bound is about 1.5e-6 of that
+	std::snprintf(line, sizeof(line), "BoneBatch vertices match one transform per vertex (max %.2g, normals %.2g)",
+		vertexError, normalError);
+	Check(vertexError <= 2e-5 && normalError <= 2e-6, line);
+
+	// the cost per bone: transforming the mesh on the CPU, and only packing the instance
+	// (drawing either needs a GL context, so that is left out)
+	const long FRAMES = 20000;
+	double batchTime = NanosecondsPerCall(FRAMES, [&]()
+		{ // batched
+		batch.Begin(BONE_SLICES);
+		for (int bone = 0; bone < BONES; bone++)
+			batch.AddCylinder(transforms[bone], radii[bone], lengths[bone]);
+		benchSink = benchSink + batch.Vertices()[0].x;
+		}) / BONES;
+	BoneRenderer instanced;
+	double instanceTime = NanosecondsPerCall(FRAMES, [&]()
+		{ // instanced
+		instanced.Begin();
+		for (int bone = 0; bone < BONES; bone++)
+			instanced.AddCylinder(transforms[bone], radii[bone], lengths[bone]);
+		benchSink = benchSink + instanced.Bones();
+		}) / BONES;
+	std::printf("per bone, %d slices: BoneBatch %.1f ns (%.0f bones/ms), BoneRenderer instance %.1f ns (%.0f bones/ms)\n",
+		BONE_SLICES, batchTime, 1e6 / batchTime, instanceTime, 1e6 / instanceTime);
+	return benchFailures ? 1 : 0;
+	} // main()
@@ -0,0 +1,219 @@
+// the retained-mode renderers against the immediate-mode drawing they replaced, on a
+// headless context: the same frame through each must come out (nearly) the same image,
+// then the CPU time of a frame is measured, both to submit it and to have it drawn
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "BoneRenderer.h"
+#include "SurfaceRenderer.h"
+#include "Terrain.h"
+#include "HeadlessGL.h"
+#include "Bench.h"
+
+// the size of the frames compared
+static const int FRAME_SIZE = 600;
+
+// the bones as BVHData drew them before the batch: a cylinder of triangles per bone, each
+// vertex transformed on the CPU and passed down with glVertex
+static void ImmediateCylinder(Matrix4& viewMatrix, float radius, float length, int slices)
+	{ // ImmediateCylinder()
+	glBegin(GL_TRIANGLES);
+	for (int i = 0; i < slices; i++)
+		{ // per slice
+		float theta = (float)(i * 2.0f * M_PI / slices);
+		float nextTheta = (float)((i + 1) * 2.0f * M_PI / slices);
+		float midTheta = 0.5 * (theta + nextTheta);
+		Homogeneous4 center_up = viewMatrix * Homogeneous4(0.0, 0.0, length, 1);
+		Homogeneous4 c_edge1 = viewMatrix * Homogeneous4(radius * cos(theta), radius * sin(theta), length, 1);
+		Homogeneous4 c_edge2 = viewMatrix * Homogeneous4(radius * cos(nextTheta), radius * sin(nextTheta), length, 1);
+		Homogeneous4 c_edge3 = viewMatrix * Homogeneous4(radius * cos(nextTheta), radius * sin(nextTheta), 0, 1);
+		Homogeneous4 c_edge4 = viewMatrix * Homogeneous4(radius * cos(theta), radius * sin(theta), 0, 1);
+		Homogeneous4 center_bottom = viewMatrix * Homogeneous4(0.0, 0.0, 0, 1);
+		Cartesian3 normal_up = viewMatrix * Cartesian3(0, 0, 1.0) - viewMatrix * Cartesian3(0.0, 0.0, 0.0);
+		Cartesian3 normal_edge = viewMatrix * Cartesian3(cos(midTheta), sin(midTheta), 0.0) - viewMatrix * Cartesian3(0.0, 0.0, 0.0);
+		Cartesian3 normal_bottom = viewMatrix * Cartesian3(0, 0, -1.0) - viewMatrix * Cartesian3(0.0, 0.0, 0.0);
+
+		glNormal3fv(&normal_up.x);
+		glVertex4fv(&center_up.x);
+		glVertex4fv(&c_edge1.x);
+		glVertex4fv(&c_edge2.x);
+
+		glNormal3fv(&normal_edge.x);
+		glVertex4fv(&c_edge2.x);
+		glVertex4fv(&c_edge1.x);
+		glVertex4fv(&c_edge4.x);
+
+		glNormal3fv(&normal_edge.x);
+		glVertex4fv(&c_edge2.x);
+		glVertex4fv(&c_edge4.x);
+		glVertex4fv(&c_edge3.x);
+
+		glNormal3fv(&normal_bottom.x);
+		glVertex4fv(&c_edge3.x);
+		glVertex4fv(&c_edge4.x);
+		glVertex4fv(&center_bottom.x);
+		} // per slice
+	glEnd();
+	} // ImmediateCylinder()
+
+// one pose of a clip drawn bone by bone that way
+static void ImmediateBones(const BVHData& clip, Matrix4& viewMatrix, int frame, std::vector<Affine3>& local, std::vector<Affine3>& global)
+	{ // ImmediateBones()
+	const Skeleton& rig = *clip.skeleton;
+	clip.EvaluatePose(frame, 1.0f, local.data(), global.data());
+	for (int joint = 0; joint < rig.JointCount(); joint++)
+		{ // per joint
+		int parent = rig.parentBones[joint];
+		if (parent < 0)
+			continue;
+		Cartesian3 start = global[parent].Translation();
+		Cartesian3 diff = global[joint].Translation() - start;
+		Affine3 cylinder = Affine3::RotateDirection(diff.unit());
+		cylinder.SetTranslation(start);
+		Matrix4 cyMatrix = viewMatrix * cylinder;
+		ImmediateCylinder(cyMatrix, 1.0f, diff.length(), BONE_SLICES);
+		} // per joint
+	} // ImmediateBones()
+
+// the CPU time of a frame in milliseconds: to submit it, and to have it drawn as well
+struct FrameTime
+	{ // struct FrameTime
+	double submit = 0.0;
+	double drawn = 0.0;
+	}; // struct FrameTime
+
+template <typename Frame> FrameTime TimeFrames(int frames, Frame frame)
+	{ // TimeFrames()
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+	// one untimed frame, to warm the caches and let the driver compile its state
+	frame(0);
+	glFinish();
+	FrameTime time;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int f = 0; f < frames; f++)
+		{ // per frame
+		std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+		frame(f);
+		time.submit += Milliseconds(std::chrono::steady_clock::now() - submitted).count();
+		glFinish();
+		} // per frame
+	time.drawn = Milliseconds(std::chrono::steady_clock::now() - start).count() / frames;
+	time.submit /= frames;
+	return time;
+	} // TimeFrames()
+
+int main()
+	{ // main()
+	HeadlessGL context;
+	if (!context.Open(FRAME_SIZE, FRAME_SIZE))
+		{ // no context
+		std::printf("skipped: the renderers need a headless GL context to be compared\n");
+		return 0;
+		} // no context
+	char line[160];
+
+	// bones: a crowd of runners, each a frame further on, in a grid in front of the camera
+	std::shared_ptr<BVHData> run = ReadClip("models/fast_run.bvh");
+	if (!run)
+		return 1;
+	const int CHARACTERS = 16;
+	const GLfloat boneColour[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	std::vector<Matrix4> views(CHARACTERS);
+	for (int character = 0; character < CHARACTERS; character++)
+		{ // per character
+		float x = (character % 4 - 1.5f) * 60.0f, z = (character / 4) * 60.0f;
+		views[character] = Matrix4::Translate(Cartesian3(x, -90.0f, -150.0f - z)) * Matrix4::RotateY(30.0f);
+		} // per character
+
+	BoneRenderer instanced;
+	Check(instanced.Initialise(HeadlessGL::ProcAddress), "the instanced bone renderer is ready");
+	std::vector<Affine3> local(run->skeleton->JointCount()), global(run->skeleton->JointCount());
+	auto immediateBones = [&](int frame)
+		{ // immediateBones()
+		context.BeginFrame(boneColour);
+		for (int character = 0; character < CHARACTERS; character++)
+			ImmediateBones(*run, views[character], (frame + character) % run->frame_count, local, global);
+		}; // immediateBones()
+	// Render with no bone renderer batches each character's bones on the CPU
+	auto batchedBones = [&](int frame)
+		{ // batchedBones()
+		context.BeginFrame(boneColour);
+		run->boneRenderer = nullptr;
+		for (int character = 0; character < CHARACTERS; character++)
+			run->Render(views[character], 1.0f, frame + character);
+		}; // batchedBones()
+	// and with one, gathers every bone of the crowd into one instanced call
+	auto instancedBones = [&](int frame)
+		{ // instancedBones()
+		context.BeginFrame(boneColour);
+		run->boneRenderer = &instanced;
+		instanced.Begin();
+		for (int character = 0; character < CHARACTERS; character++)
+			run->Render(views[character], 1.0f, frame + character);
+		instanced.Draw();
+		}; // instancedBones()
+
+	// the triangles are the same ones, so only pixels on their edges (where the vertices
+	// round differently) or lit by a normal a little different may differ
+	immediateBones(5);
+	std::vector<unsigned char> reference = context.ReadPixels();
+	batchedBones(5);
+	ImageDifference batched = CompareImages(reference, context.ReadPixels());
+	instancedBones(5);
+	ImageDifference drawn = CompareImages(reference, context.ReadPixels());
+	std::sprintf(line, "batched bones match immediate mode (%ld of %ld covered pixels differ, by up to %d)",
+		batched.differing, batched.covered, batched.largest);
+	Check(batched.covered > 0 && batched.differing * 100 <= batched.covered && batched.largest <= 8, line);
+	std::sprintf(line, "instanced bones match immediate mode (%ld of %ld covered pixels differ, by up to %d)",
+		drawn.differing, drawn.covered, drawn.largest);
+	Check(drawn.covered > 0 && drawn.differing * 100 <= drawn.covered && drawn.largest <= 8, line);
+
+	const int FRAMES = 100;
+	FrameTime immediateTime = TimeFrames(FRAMES, immediateBones);
+	FrameTime batchedTime = TimeFrames(FRAMES, batchedBones);
+	FrameTime instancedTime = TimeFrames(FRAMES, instancedBones);
+	std::printf("%d characters of bones, ms per frame  submitted  drawn\n", CHARACTERS);
+	std::printf("  immediate mode (glBegin)         %8.3f  %8.3f\n", immediateTime.submit, immediateTime.drawn);
+	std::printf("  batched (client arrays)          %8.3f  %8.3f\n", batchedTime.submit, batchedTime.drawn);
+	std::printf("  instanced (buffers and shader)   %8.3f  %8.3f\n", instancedTime.submit, instancedTime.drawn);
+	instanced.Release();
+
+	// terrain: the ground of the scene, seen from above at an angle
+	Terrain ground;
+	if (!ground.ReadFileTerrainData("models/randomland.dem", 20))
+		{ // no terrain
+		std::printf("cannot read models/randomland.dem: run the benchmarks from the top of the tree\n");
+		return 1;
+		} // no terrain
+	const GLfloat groundColour[4] = { 0.3f, 0.5f, 0.2f, 1.0f };
+	Matrix4 groundView = Matrix4::Translate(Cartesian3(0.0f, -200.0f, -800.0f)) * Matrix4::RotateX(-60.0f);
+	SurfaceRenderer buffered;
+	Check(buffered.Initialise(HeadlessGL::ProcAddress, ground), "the terrain renderer is ready");
+	auto immediateGround = [&](int)
+		{ // immediateGround()
+		context.BeginFrame(groundColour);
+		ground.Render(groundView);
+		}; // immediateGround()
+	auto bufferedGround = [&](int)
+		{ // bufferedGround()
+		context.BeginFrame(groundColour);
+		buffered.Draw(groundView);
+		}; // bufferedGround()
+
+	immediateGround(0);
+	reference = context.ReadPixels();
+	bufferedGround(0);
+	ImageDifference terrain = CompareImages(reference, context.ReadPixels());
+	std::sprintf(line, "buffered terrain matches immediate mode (%ld of %ld covered pixels differ, by up to %d)",
+		terrain.differing, terrain.covered, terrain.largest);
+	Check(terrain.covered > 0 && terrain.differing * 100 <= terrain.covered && terrain.largest <= 8, line);
+
+	FrameTime immediateGroundTime = TimeFrames(FRAMES, immediateGround);
+	FrameTime bufferedGroundTime = TimeFrames(FRAMES, bufferedGround);
+	std::printf("terrain of %zu triangles, ms per frame  submitted  drawn\n", ground.normals.size());
+	std::printf("  immediate mode (glBegin)         %8.3f  %8.3f\n", immediateGroundTime.submit, immediateGroundTime.drawn);
+	std::printf("  buffered (buffers and shader)    %8.3f  %8.3f\n", bufferedGroundTime.submit, bufferedGroundTime.drawn);
+	buffered.Release();
+
+	return benchFailures ? 1 : 0;
+	} // main()
@@ -0,0 +1,277 @@
+// sampling a clip, against the representations it replaced: the contiguous tracks against
+// a vector per frame, the tracks of a compiled clip used where they are mapped, the compiled channel layout against matching channel names, the
+// precomputed orientations against converting Euler angles per sample, and sampling
+// between frames in each mode
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "BVHClipFile.h"
+#include "Bench.h"
+
+// the old per-sample conversion of a (negated) Euler rotation, composed z, y, x
+static Quaternion EulerToQuaternion(const Cartesian3& angles)
+	{ // EulerToQuaternion()
+	Quaternion rotX = Quaternion(angles.x, Cartesian3(1.0f, 0.0f, 0.0f).unit());
+	rotX.Normalize();
+	Quaternion rotY = Quaternion(angles.y, Cartesian3(0.0f, 1.0f, 0.0f).unit());
+	rotY.Normalize();
+	Quaternion rotZ = Quaternion(angles.z, Cartesian3(0.0f, 0.0f, 1.0f).unit());
+	rotZ.Normalize();
+	return (rotZ * rotY) * rotX;
+	} // EulerToQuaternion()
+
+// the old channel lookup, by name
+static std::map<std::string, int> channelByName;
+
+// the old SamplePosition: match each of the joint's channel names, every call
+static Cartesian3 SamplePositionByName(const std::vector<std::vector<float>>& frames, const Skeleton& rig, int frame, int joint)
+	{ // SamplePositionByName()
+	Cartesian3 position(0.0f, 0.0f, 0.0f);
+	const std::vector<std::string>& channels = rig.jointChannels[joint];
+	for (size_t i = 0; i < channels.size(); i++)
+		{ // per channel
+		const std::string& channel = channels[i];
+		float value = frames[frame][channelByName[channel]];
+		if (channel == "Xposition")
+			position.x = value;
+		if (channel == "Yposition")
+			position.y = value;
+		if (channel == "Zposition")
+			position.z = value;
+		} // per channel
+	return position;
+	} // SamplePositionByName()
+
+// the orientation of every joint at a frame, as a sampling mode gives it
+struct PoseRows
+	{ // struct PoseRows
+	std::vector<float> data;
+	int count;
+	explicit PoseRows(int count) : data(4 * count), count(count) {}
+	float* Row(int component) { return data.data() + component * count; }
+	Quaternion At(int joint) const { return Quaternion(data[joint], data[count + joint], data[2 * count + joint], data[3 * count + joint]); }
+	}; // struct PoseRows
+
+int main()
+	{ // main()
+	std::shared_ptr<BVHData> run = ReadClip("models/fast_run.bvh");
+	if (!run)
+		return 1;
+	const Skeleton& rig = *run->skeleton;
+	int jointCount = rig.JointCount();
+	int frameCount = run->frame_count;
+	char line[160];
+	std::mt19937 random(5);
+
+	// the contiguous tracks against one vector per frame, over a clip long enough
+	// (the run repeated) that it does not fit in the caches
+	const int LONG_FRAMES = 20000;
+	AnimationTracks longTracks;
+	longTracks.Resize(LONG_FRAMES, jointCount, run->tracks.ChannelCount());
+	std::vector<std::vector<Cartesian3>> rotationsPerFrame(LONG_FRAMES);
+	for (int frame = 0; frame < LONG_FRAMES; frame++)
+		for (int joint = 0; joint < jointCount; joint++)
+			{ // per joint
+			Cartesian3 rotation = run->tracks.Rotation(frame % frameCount, joint);
+			longTracks.SetRotation(frame, joint, rotation);
+			rotationsPerFrame[frame].push_back(rotation);
+			} // per joint
+	std::vector<int> order(LONG_FRAMES);
+	for (int frame = 0; frame < LONG_FRAMES; frame++)
+		order[frame] = frame;
+	std::shuffle(order.begin(), order.end(), random);
+	bool sameRotations = true;
+	for (int frame : order)
+		for (int joint = 0; joint < jointCount; joint++)
+			{ // per joint
+			Cartesian3 perFrame = rotationsPerFrame[frame][joint];
+			Cartesian3 tracked = longTracks.Rotation(frame, joint);
+			sameRotations = sameRotations && perFrame.x == tracked.x && perFrame.y == tracked.y && perFrame.z == tracked.z;
+			} // per joint
+	Check(sameRotations, "the tracks hold the same rotations as a vector per frame");
+	double perFrameTime = NanosecondsPerCall(10, [&]()
+		{ // a vector per frame
+		float sum = 0.0f;
+		for (int frame : order)
+			for (int joint = 0; joint < jointCount; joint++)
+				{ // per joint
+				const Cartesian3& rotation = rotationsPerFrame[frame][joint];
+				sum += rotation.x + rotation.y + rotation.z;
+				} // per joint
+		benchSink = benchSink + sum;
+		}) / ((double) LONG_FRAMES * jointCount);
+	double gatherTime = NanosecondsPerCall(10, [&]()
+		{ // tracks, a joint at a time
+		float sum = 0.0f;
+		for (int frame : order)
+			for (int joint = 0; joint < jointCount; joint++)
+				{ // per joint
+				Cartesian3 rotation = longTracks.Rotation(frame, joint);
+				sum += rotation.x + rotation.y + rotation.z;
+				} // per joint
+		benchSink = benchSink + sum;
+		}) / ((double) LONG_FRAMES * jointCount);
+	double rowTime = NanosecondsPerCall(10, [&]()
+		{ // tracks, a row at a time
+		float sum = 0.0f;
+		for (int frame : order)
+			{ // per frame
+			size_t row = (size_t) frame * longTracks.JointStride();
+			const float* x = longTracks.RotationTrack(0) + row;
+			const float* y = longTracks.RotationTrack(1) + row;
+			const float* z = longTracks.RotationTrack(2) + row;
+			for (int joint = 0; joint < jointCount; joint++)
+				sum += x[joint] + y[joint] + z[joint];
+			} // per frame
+		benchSink = benchSink + sum;
+		}) / ((double) LONG_FRAMES * jointCount);
+	std::printf("rotation per joint, frames in random order (%d frames, %.1f MB): vector per frame %.2f ns,"
+		" tracks %.2f ns by Rotation(), %.2f ns by rows\n", LONG_FRAMES, longTracks.Bytes() / 1048576.0, perFrameTime, gatherTime, rowTime);
+
+	// a frame line holding integers (as exporters write a zero) parses every one of them
+	std::vector<std::string_view> tokens = { "0", "-12", "+3", "1.5", "2e1" };
+	float parsed[5];
+	bool integers = BVHTokenizer::ParseFrame(tokens, parsed, 5) && parsed[0] == 0.0f && parsed[1] == -12.0f && parsed[2] == 3.0f
+		&& parsed[3] == 1.5f && parsed[4] == 20.0f && !BVHTokenizer::ParseFrame(tokens, parsed, 4);
+	Check(integers, "a frame line of integers and decimals parses to exactly one value per channel");
+
+	// the compiled clip (written by the first load if it is not there yet) is used in place,
+	// holds the same tracks as the text bit for bit, and is refused once the text changes
+	const char* RUN_FILE = "models/fast_run.bvh";
+	BVHData compiled;
+	bool cached = compiled.LoadClip(RUN_FILE) && compiled.LoadClip(RUN_FILE) && compiled.tracks.IsView()
+		&& compiled.tracks.Bytes() == run->tracks.Bytes()
+		&& std::memcmp(compiled.tracks.Data(), run->tracks.Data(), run->tracks.Bytes()) == 0;
+	Check(cached, "a compiled clip's tracks are used where they are mapped, and match the text bit for bit");
+	BVHClipSource source = { 0, 0 }, edited;
+	StatClipSource(RUN_FILE, source);
+	edited = source;
+	edited.size++;
+	std::string compiledName = std::string(RUN_FILE) + "c";
+	bool stale = compiled.ReadFileBVHC(compiledName.c_str(), DEFAULT_ROLE_MAP, &source)
+		&& !compiled.ReadFileBVHC(compiledName.c_str(), DEFAULT_ROLE_MAP, &edited);
+	edited = source;
+	edited.modified++;
+	stale = stale && !compiled.ReadFileBVHC(compiledName.c_str(), DEFAULT_ROLE_MAP, &edited);
+	Check(stale, "a compiled clip is refused if the text's size or time (to the nanosecond) has changed");
+	double textLoadTime = NanosecondsPerCall(20, [&]()
+		{ // text
+		compiled.ReadFileBVH(RUN_FILE);
+		});
+	double compiledLoadTime = NanosecondsPerCall(200, [&]()
+		{ // compiled
+		compiled.ReadFileBVHC(compiledName.c_str());
+		});
+	std::printf("loading %s: text %.0f us, compiled %.0f us\n", RUN_FILE, textLoadTime / 1000.0, compiledLoadTime / 1000.0);
+
+	// the compiled channel layout against matching the channel names
+	const char* const names[6] = { "Xposition", "Yposition", "Zposition", "Xrotation", "Yrotation", "Zrotation" };
+	for (int code = 0; code < 6; code++)
+		channelByName[names[code]] = code;
+	std::vector<std::vector<float>> framesPerVector(frameCount);
+	for (int frame = 0; frame < frameCount; frame++)
+		framesPerVector[frame].assign(run->tracks.FrameChannels(frame), run->tracks.FrameChannels(frame) + run->tracks.ChannelCount());
+	bool samePositions = true;
+	for (int frame = 0; frame < frameCount; frame++)
+		for (int joint = 0; joint < jointCount; joint++)
+			{ // per joint
+			Cartesian3 compiled = run->SamplePosition(frame, joint);
+			Cartesian3 byName = SamplePositionByName(framesPerVector, rig, frame, joint);
+			samePositions = samePositions && compiled.x == byName.x && compiled.y == byName.y && compiled.z == byName.z;
+			} // per joint
+	Check(samePositions, "SamplePosition matches the channel names (only the root has position channels)");
+	double byNameTime = NanosecondsPerCall(2000, [&]()
+		{ // by name
+		for (int joint = 0; joint < jointCount; joint++)
+			benchSink = benchSink + SamplePositionByName(framesPerVector, rig, joint % frameCount, joint).y;
+		}) / jointCount;
+	double compiledTime = NanosecondsPerCall(2000, [&]()
+		{ // compiled
+		for (int joint = 0; joint < jointCount; joint++)
+			benchSink = benchSink + run->SamplePosition(joint % frameCount, joint).y;
+		}) / jointCount;
+	std::printf("SamplePosition per joint: by channel name %.2f ns, compiled layout %.2f ns\n", byNameTime, compiledTime);
+
+	// the precomputed orientations against converting the Euler angles on every sample
+	bool sameOrientations = true;
+	int xyzJoints = 0;
+	for (int joint = 0; joint < jointCount; joint++)
+		if (rig.channelMap[joint].rotationOrder == ROTATION_XYZ)
+			{ // joints keyed x, y, z
+			xyzJoints++;
+			for (int frame = 0; frame < frameCount; frame++)
+				{ // per frame
+				Quaternion converted = EulerToQuaternion(run->SampleAnimation(frame, joint));
+				Quaternion stored = run->tracks.Orientation(frame, joint);
+				sameOrientations = sameOrientations && std::memcmp(&converted, &stored, sizeof(Quaternion)) == 0;
+				} // per frame
+			} // joints keyed x, y, z
+	std::snprintf(line, sizeof(line), "the stored orientations match the per-sample conversion bit for bit (%d XYZ joints)", xyzJoints);
+	Check(xyzJoints > 0 && sameOrientations, line);
+	double convertTime = NanosecondsPerCall(2000, [&]()
+		{ // convert
+		for (int joint = 0; joint < jointCount; joint++)
+			benchSink = benchSink + EulerToQuaternion(run->SampleAnimation(joint % frameCount, joint)).w;
+		}) / jointCount;
+	double storedTime = NanosecondsPerCall(2000, [&]()
+		{ // stored
+		for (int joint = 0; joint < jointCount; joint++)
+			benchSink = benchSink + run->tracks.Orientation(joint % frameCount, joint).w;
+		}) / jointCount;
+	std::printf("orientation per joint: converted from Euler %.2f ns, stored %.2f ns\n", convertTime, storedTime);
+
+	// sampling between frames, in each mode
+	run->BuildCubicTracks();
+	PoseRows key(jointCount), sampled(jointCount);
+	float* keyRows[4] = { key.Row(0), key.Row(1), key.Row(2), key.Row(3) };
+	float* sampledRows[4] = { sampled.Row(0), sampled.Row(1), sampled.Row(2), sampled.Row(3) };
+	double cubicEndError = 0.0, linearError = 0.0, cubicFromLinear = 0.0;
+	for (int frame = 0; frame < frameCount; frame++)
+		{ // per frame
+		int next = (frame + 1) % frameCount;
+		// the cubic passes through the keys at both ends
+		for (float fraction : { 0.0f, 1.0f })
+			{ // per end
+			run->SampleOrientations(fraction > 0.0f ? next : frame, 0.0f, SAMPLE_STEP, BLEND_EXACT, keyRows);
+			run->SampleOrientations(frame, fraction, SAMPLE_CUBIC, BLEND_EXACT, sampledRows);
+			for (int joint = 0; joint < jointCount; joint++)
+				cubicEndError = std::max(cubicEndError, AngleBetween(key.At(joint), sampled.At(joint)));
+			} // per end
+		// linear half way is the slerp of the keys, and the cubic bends away from it
+		run->SampleOrientations(frame, 0.5f, SAMPLE_LINEAR, BLEND_EXACT, keyRows);
+		run->SampleOrientations(frame, 0.5f, SAMPLE_CUBIC, BLEND_EXACT, sampledRows);
+		for (int joint = 0; joint < jointCount; joint++)
+			{ // per joint
+			Quaternion halfway = Slerp(run->tracks.Orientation(frame, joint), run->tracks.Orientation(next, joint), 0.5f);
+			linearError = std::max(linearError, AngleBetween(key.At(joint), halfway));
+			cubicFromLinear = std::max(cubicFromLinear, AngleBetween(key.At(joint), sampled.At(joint)));
+			} // per joint
+		} // per frame
+	std::snprintf(line, sizeof(line), "SAMPLE_CUBIC passes through the keys at both ends of each span (max %.2g rad)", cubicEndError);
+	Check(cubicEndError <= 1e-6, line);
+	std::snprintf(line, sizeof(line), "SAMPLE_LINEAR half way is the slerp of the keys (max %.2g rad from Slerp())", linearError);
+	Check(linearError <= 1e-5, line);
+	std::printf("SAMPLE_CUBIC half way is at most %.2g rad from SAMPLE_LINEAR\n", cubicFromLinear);
+	std::printf("cubic tangents %zu bytes, against %zu bytes of tracks\n", run->CubicTrackBytes(), run->tracks.Bytes());
+
+	// and what each costs per pose
+	struct ModeCost { const char* name; SampleMode mode; BlendAccuracy accuracy; };
+	const ModeCost MODES[4] = { { "step", SAMPLE_STEP, BLEND_EXACT }, { "linear exact", SAMPLE_LINEAR, BLEND_EXACT },
+		{ "linear fast", SAMPLE_LINEAR, BLEND_FAST }, { "cubic", SAMPLE_CUBIC, BLEND_EXACT } };
+	std::printf("per pose of %d joints:", jointCount);
+	for (const ModeCost& cost : MODES)
+		{ // per mode
+		long call = 0;
+		double nanoseconds = NanosecondsPerCall(200000, [&]()
+			{ // sample
+			run->SampleOrientations(call % frameCount, 0.3f, cost.mode, cost.accuracy, sampledRows);
+			call++;
+			});
+		benchSink = benchSink + sampled.data[0];
+		std::printf(" %s %.0f ns%s", cost.name, nanoseconds, (&cost == MODES + 3) ? "\n" : ",");
+		} // per mode
+	return benchFailures ? 1 : 0;
+	} // main()
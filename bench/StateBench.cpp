@@ -0,0 +1,170 @@
+// the state machine and the blend spaces it plays: the weights a blend space gives,
+// that the pose moves smoothly along it, that interrupted cross-fades carry on from
+// where they were, and what a character costs to update and blend
+#include <algorithm>
+#include <vector>
+#include "AnimationStateMachine.h"
+#include "Bench.h"
+
+// the largest angle between two blended poses
+static double PoseDistance(const PoseBlender& a, const PoseBlender& b)
+	{ // PoseDistance()
+	double distance = 0.0;
+	for (int joint = 0; joint < a.JointCount(); joint++)
+		distance = std::max(distance, AngleBetween(a.Rotation(joint), b.Rotation(joint)));
+	return distance;
+	} // PoseDistance()
+
+// the sum of the weights of the inputs
+static float TotalWeight(const std::vector<BlendInput>& inputs)
+	{ // TotalWeight()
+	float total = 0.0f;
+	for (const BlendInput& input : inputs)
+		total += input.weight;
+	return total;
+	} // TotalWeight()
+
+int main()
+	{ // main()
+	ClipHandle run = ReadClip("models/fast_run.bvh");
+	ClipHandle left = ReadClip("models/veer_left.bvh");
+	ClipHandle right = ReadClip("models/veer_right.bvh");
+	if (!run || !left || !right)
+		return 1;
+	char line[160];
+
+	// steering from -1 (all the way left) to 1 (all the way right)
+	std::shared_ptr<BlendSpace1D> steering = std::make_shared<BlendSpace1D>();
+	steering->AddClip(right, 1.0f);
+	steering->AddClip(run, 0.0f);
+	steering->AddClip(left, -1.0f);
+
+	// the weights: one clip at a clip's own position or off either end, else the two either side
+	std::vector<BlendInput> inputs;
+	bool weighted = true;
+	steering->Inputs(0.0f, 0.0, 1.0f, inputs);
+	weighted = weighted && inputs.size() == 1 && inputs[0].clip == run.get() && inputs[0].weight == 1.0f;
+	steering->Inputs(-0.25f, 0.0, 1.0f, inputs);
+	weighted = weighted && inputs.size() == 3 && inputs[1].clip == left.get() && inputs[1].weight == 0.25f
+		&& inputs[2].clip == run.get() && inputs[2].weight == 0.75f;
+	inputs.clear();
+	steering->Inputs(2.0f, 0.0, 0.5f, inputs);
+	weighted = weighted && inputs.size() == 1 && inputs[0].clip == right.get() && inputs[0].weight == 0.5f;
+	Check(weighted, "BlendSpace1D weights the clips either side of the parameter, and adds to the inputs");
+
+	// every clip at the same phase of its own cycle, however long it is
+	inputs.clear();
+	steering->Inputs(0.5f, 0.5, 1.0f, inputs);
+	bool inStep = inputs.size() == 2;
+	for (const BlendInput& input : inputs)
+		inStep = inStep && std::fabs((input.frame + input.fraction) / input.clip->frame_count - 0.5) < 1e-6;
+	double runCycle = (double) run->frame_count * run->frame_time, rightCycle = (double) right->frame_count * right->frame_time;
+	inStep = inStep && std::fabs(steering->CycleDuration(0.5f) - 0.5 * (runCycle + rightCycle)) < 1e-9;
+	std::snprintf(line, sizeof(line), "the clips play at the same phase, over a cycle blended between them (%.3g s and %.3g s)",
+		runCycle, rightCycle);
+	Check(inStep, line);
+
+	// the pose moves smoothly as the parameter sweeps across the space, at any phase
+	// (over time the veers jump where they wrap round, as they are one-shot turns, not loops)
+	PoseBlender before, after;
+	const int STEPS = 480;
+	double largestStep = 0.0;
+	for (int phaseStep = 0; phaseStep < 16; phaseStep++)
+		{ // per phase
+		double phase = phaseStep / 16.0;
+		for (int step = 0; step <= STEPS; step++)
+			{ // per step
+			inputs.clear();
+			steering->Inputs(-1.2f + 2.4f * step / STEPS, phase, 1.0f, inputs);
+			after.Evaluate(inputs);
+			if (step > 0)
+				largestStep = std::max(largestStep, PoseDistance(before, after));
+			std::swap(before, after);
+			} // per step
+		} // per phase
+	std::snprintf(line, sizeof(line), "sweeping the parameter across the space in %d steps moves no joint more than %.3g rad a step",
+		STEPS, largestStep);
+	Check(largestStep < 0.05, line);
+
+	// a state machine steering a character: the inputs of the blend space state add up
+	// to one all the way across, and its phase moves on at the rate of the space
+	AnimationStateMachine machine;
+	int steer = machine.AddState("Steer", std::shared_ptr<const BlendSpace1D>(steering));
+	int idle = machine.AddState("Idle", run);
+	machine.AddTransition(ANY_STATE, steer, 0.25f);
+	machine.AddTransition(steer, idle, 0.25f);
+	machine.Compile();
+	AnimationStateInstance character = machine.Start(steer);
+	const float DT = 1.0f / 120.0f;
+	bool addsUp = true, phaseRate = true;
+	for (int step = 1; step <= STEPS; step++)
+		{ // per step
+		AnimationStateMachine::SetParameter(character, -1.2f + 2.4f * step / STEPS);
+		float phase = character.phase;
+		machine.Update(&character, 1, DT);
+		double expected = phase + DT / steering->CycleDuration(character.parameter);
+		phaseRate = phaseRate && std::fabs(character.phase - (expected - std::floor(expected))) < 1e-6;
+		machine.InputsAtTime(character, step * DT, inputs);
+		addsUp = addsUp && std::fabs(TotalWeight(inputs) - 1.0f) < 1e-6f;
+		} // per step
+	Check(addsUp, "the blend space state's inputs add up to one all the way across");
+	Check(phaseRate, "the phase moves on by dt over the cycle at the parameter");
+
+	// cross-fades interrupted one after another: asking for the next state part way through
+	// the fade barely moves the pose, however many fades are in flight, and the weights add up
+	AnimationStateMachine clips;
+	int clipStates[3] = { clips.AddState("Run", run), clips.AddState("Left", left), clips.AddState("Right", right) };
+	clips.AddTransition(ANY_STATE, clipStates[0], 0.25f);
+	clips.AddTransition(ANY_STATE, clipStates[1], 0.25f);
+	clips.AddTransition(ANY_STATE, clipStates[2], 0.25f);
+	clips.Compile();
+	AnimationStateInstance fader = clips.Start(clipStates[0]);
+	const int FRAME = 10;
+	double largestJump = 0.0;
+	bool faded = true;
+	for (int interruption = 1; interruption <= 6; interruption++)
+		{ // per interruption
+		// a tenth of the way in, then the next state (a tiny step, so only the interruption moves the pose)
+		clips.Update(&fader, 1, 0.025f);
+		clips.Inputs(fader, FRAME, inputs);
+		before.Evaluate(inputs);
+		AnimationStateMachine::Request(fader, clipStates[interruption % 3]);
+		clips.Update(&fader, 1, 1e-5f);
+		clips.Inputs(fader, FRAME, inputs);
+		after.Evaluate(inputs);
+		largestJump = std::max(largestJump, PoseDistance(before, after));
+		faded = faded && fader.current == clipStates[interruption % 3] && std::fabs(TotalWeight(inputs) - 1.0f) < 1e-6f;
+		} // per interruption
+	std::snprintf(line, sizeof(line), "interrupting a cross-fade a tenth of the way in moves no joint more than %.2g rad"
+		" (it used to snap to the state faded into)", largestJump);
+	Check(largestJump < 0.01, line);
+	Check(faded, "the weights add up to one with several cross-fades in flight");
+	// requests for states that are not there are dropped
+	AnimationStateInstance kept = fader;
+	AnimationStateMachine::Request(fader, 3);
+	clips.Update(&fader, 1, 0.0f);
+	AnimationStateMachine::Request(fader, -5);
+	clips.Update(&fader, 1, 0.0f);
+	Check(fader.current == kept.current && fader.requested == -1, "requests for states that are not there are dropped");
+
+	// the cost of a crowd, updated in one loop, then blended one by one
+	const int CROWD = 1000;
+	std::vector<AnimationStateInstance> crowd(CROWD, machine.Start(steer));
+	for (int index = 0; index < CROWD; index++)
+		AnimationStateMachine::SetParameter(crowd[index], -1.0f + 2.0f * index / CROWD);
+	double updateTime = NanosecondsPerCall(2000, [&]()
+		{ // update
+		machine.Update(crowd.data(), crowd.size(), DT);
+		}) / CROWD;
+	double blendTime = NanosecondsPerCall(20, [&]()
+		{ // blend
+		for (const AnimationStateInstance& member : crowd)
+			{ // per character
+			machine.InputsAtTime(member, 1.0, inputs);
+			before.Evaluate(inputs);
+			} // per character
+		benchSink = benchSink + before.Rotation(0).w;
+		}) / CROWD;
+	std::printf("per character of %d: Update %.1f ns, blend space inputs and pose %.0f ns\n", CROWD, updateTime, blendTime);
+	return benchFailures ? 1 : 0;
+	} // main()